@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * ARENA
+ * See arena.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // malloc, free
+#include <string.h>   // memcpy
+#include <stdint.h>   // uintptr_t
+#include "arena.h"
+
+static size_t roundup(const size_t size)
+{
+    return (size + ARENAALIGN - 1) & ~(ARENAALIGN - 1);
+}
+
+static ArenaChunk *newchunk(Arena *a, const size_t size)
+{
+    ArenaChunk *c = malloc(sizeof *c + size);
+    if (!c)
+        return NULL;
+    c->next = a->chunk;
+    c->size = size;
+    a->chunk = c;
+    a->used = 0;
+    a->mallocs++;
+    return c;
+}
+
+void *arenaalloc(Arena *a, const size_t size)
+{
+    const size_t need = roundup(size ? size : 1);
+    if (!need)
+        return NULL;  // overflow
+    ArenaChunk *c = a->chunk;
+    if (!c || c->size - a->used < need) {
+        // Double the chunk size so the number of chunks per file stays small
+        size_t chunksize = c ? c->size * 2 : ARENACHUNK;
+        if (chunksize < need)
+            chunksize = need;
+        if (!(c = newchunk(a, chunksize)))
+            return NULL;
+    }
+    void *p = c->data + a->used;
+    a->used += need;
+    return p;
+}
+
+void *arenarealloc(Arena *a, void *p, const size_t oldsize, const size_t newsize)
+{
+    if (p) {
+        ArenaChunk *c = a->chunk;
+        const uintptr_t data = (uintptr_t)c->data, addr = (uintptr_t)p;
+        const size_t start = (size_t)(addr - data);
+        if (addr >= data && start < a->used && start + roundup(oldsize) == a->used) {
+            // Last allocation: move the end
+            const size_t need = roundup(newsize);
+            if (need <= c->size - start) {
+                a->used = start + need;
+                return p;
+            }
+        }
+        if (newsize <= oldsize)
+            return p;
+    }
+    void *q = arenaalloc(a, newsize);
+    if (q && p)
+        memcpy(q, p, oldsize);
+    return q;
+}
+
+char *arenastrdup(Arena *a, const char *s, const size_t len)
+{
+    char *t = arenaalloc(a, len + 1);
+    if (t) {
+        memcpy(t, s, len);
+        t[len] = '\0';
+    }
+    return t;
+}
+
+void arenareset(Arena *a)
+{
+    ArenaChunk *c = a->chunk;
+    if (c && c->next) {
+        // Several chunks: one chunk big enough for all of it next time
+        size_t total = 0;
+        for (; c; c = a->chunk) {
+            total += c->size;
+            a->chunk = c->next;
+            free(c);
+        }
+        newchunk(a, total);
+    }
+    a->used = 0;
+}
+
+void arenafree(Arena *a)
+{
+    while (a->chunk) {
+        ArenaChunk *c = a->chunk;
+        a->chunk = c->next;
+        free(c);
+    }
+    a->used = 0;
+}
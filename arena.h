@@ -0,0 +1,52 @@
+/*****************************************************************************
+ * ARENA
+ * Bump allocator for everything that belongs to one file: point columns,
+ * names and index nodes. Nothing is freed on its own; arenareset() releases
+ * it all at once and keeps the memory for the next file. When a file needed
+ * more than one chunk, the reset replaces the chunks by a single chunk of
+ * their combined size, so after the largest file has been seen a worker
+ * that reuses its arena makes no more malloc calls at all. One arena per
+ * thread: it is not thread-safe.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>   // size_t, max_align_t
+
+#define ARENACHUNK ((size_t)1 << 20)  // minimum bytes per chunk
+#define ARENAALIGN _Alignof(max_align_t)
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;  // previous, full chunk
+    size_t size;              // bytes of data
+    _Alignas(ARENAALIGN) char data[];
+} ArenaChunk;
+
+// Zero-initialised = empty arena
+typedef struct {
+    ArenaChunk *chunk;  // current chunk, NULL if none yet
+    size_t used;        // bytes used in the current chunk
+    size_t mallocs;     // chunks allocated in the lifetime of the arena
+} Arena;
+
+// Uninitialised memory for size bytes, aligned for any type; NULL if out of memory
+void *arenaalloc(Arena *a, const size_t size);
+
+// Grow or shrink an allocation of oldsize bytes (p may be NULL): in place if
+// it is the last one, else copied; the old memory stays until the reset
+void *arenarealloc(Arena *a, void *p, const size_t oldsize, const size_t newsize);
+
+// Copy of s[0..len) with a terminating NUL
+char *arenastrdup(Arena *a, const char *s, const size_t len);
+
+// Release every allocation, keep the memory
+void arenareset(Arena *a);
+
+// Return all memory to the system
+void arenafree(Arena *a);
+
+#endif
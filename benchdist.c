@@ -0,0 +1,324 @@
+/*****************************************************************************
+ * DISTANCE KERNEL BENCHMARK
+ * Times every distance method on five data sets and checks its accuracy
+ * against independent reference geodesics:
+ *
+ *     benchdist [file.gpx [geodesics.txt]]
+ *
+ * Data sets: consecutive track points from the GPX file (default e3.gpx),
+ * and from geodesics.txt random continental distances, nearly antipodal
+ * pairs, pairs near the equator and pairs across the antimeridian, with
+ * their distances from GeographicLib (made by geodesics.py). The track has
+ * no independent reference, so there the reference is Karney's method, which
+ * is itself checked on the other sets. For every method and data set it
+ * reports time and cycles per segment, Vincenty and Karney iterations to
+ * converge, and the largest absolute and relative error. The single precision
+ * kernels haversinef and flatf run on the GPX track only, because they take a
+ * path of points instead of separate segments. Exit status is 1 if any error
+ * exceeds the documented bound of the method.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>    // printf, fprintf, fopen
+#include <stdlib.h>   // malloc, realloc, free, strtod
+#include <string.h>   // strstr, strcmp
+#include <stdint.h>   // uint64_t
+#include <time.h>     // clock_gettime
+#include "geodesic.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  // __rdtsc
+#endif
+
+#define MINTIME    0.2     // seconds per measurement
+#define DATASETS   5       // the track and the sets in geodesics.txt
+#define LINELEN    1024
+#define FLOATERR   1.0     // max error in metres added by single precision
+
+typedef struct {
+    const char *name;
+    LineSegment *seg;
+    double *ref;  // reference distances
+    size_t len, cap;
+    bool self;    // reference from karney() itself, so karney is not checked
+} DataSet;
+
+// Published geodesics to check the ellipsoidal methods in absolute terms
+// Ref.: C.F.F. Karney, Algorithms for geodesics, J. Geodesy 87 (2013) 43-55
+static const struct {
+    double lat1, lon1, lat2, lon2, dist;
+} anchor[] = {
+    {-30, 0, 29.9, 179.8, 19989832.827610},  // nearly antipodal, Vincenty fails
+    {  0, 0, 90,   0,     10001965.729313},  // meridian quadrant
+    {  0, 0,  0,  90,     10018754.171394},  // quarter equator = a pi/2
+};
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Max error of each method as documented in geodesic.h, for reference distance in metres
+static double bound(const Method method, const double ref)
+{
+    switch (method) {
+        case SPHERICAL: return 0.0056 * ref;
+        case HAVERSINE: return 0.0067 * ref;
+        case ADAPTIVE:  return TOLERANCE + 5e-4;  // tolerance + error of Vincenty itself
+        case VINCENTY:  return 5e-4;
+        case KARNEY:    return 1e-6;
+        default: return 0;
+    }
+}
+
+static void *growarray(void *p, size_t *cap, const size_t size)
+{
+    *cap = *cap ? *cap * 2 : 1024;
+    p = realloc(p, *cap * size);
+    if (!p) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// Consecutive track points as line segments; only needs lat="" and lon="" on the same line
+static size_t readgpx(const char *fname, LineSegment **seg)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f)
+        return 0;
+    char buf[LINELEN];
+    double lat0 = 0, lon0 = 0;
+    size_t n = 0, cap = 0, pts = 0;
+    *seg = NULL;
+    while (fgets(buf, sizeof buf, f)) {
+        const char *s = strstr(buf, "<trkpt");
+        if (!s)
+            continue;
+        const char *lat = strstr(s, "lat=\""), *lon = strstr(s, "lon=\"");
+        if (!lat || !lon)
+            continue;
+        double lat1 = strtod(lat + 5, NULL) * DEG2RAD;
+        double lon1 = strtod(lon + 5, NULL) * DEG2RAD;
+        if (pts++) {
+            if (n == cap)
+                *seg = growarray(*seg, &cap, sizeof **seg);
+            (*seg)[n++] = (LineSegment){{lat0, lon0, lat1, lon1}};
+        }
+        lat0 = lat1;
+        lon0 = lon1;
+    }
+    fclose(f);
+    return n;
+}
+
+// Reference geodesics as "dataset lat1 lon1 lat2 lon2 distance" per line,
+// appended to the data set of that name; false if the file cannot be read
+static bool readref(const char *fname, DataSet *ds, const int n)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f)
+        return false;
+    char buf[LINELEN], name[LINELEN];
+    double lat1, lon1, lat2, lon2, dist;
+    while (fgets(buf, sizeof buf, f)) {
+        if (sscanf(buf, "%s %lf %lf %lf %lf %lf", name, &lat1, &lon1, &lat2, &lon2, &dist) != 6)
+            continue;  // comment
+        int i = 0;
+        while (i < n && strcmp(ds[i].name, name))
+            ++i;
+        if (i == n)
+            continue;
+        if (ds[i].len == ds[i].cap) {
+            size_t cap = ds[i].cap;
+            ds[i].seg = growarray(ds[i].seg, &cap, sizeof *ds[i].seg);
+            ds[i].ref = growarray(ds[i].ref, &ds[i].cap, sizeof *ds[i].ref);
+        }
+        ds[i].seg[ds[i].len] = (LineSegment){{lat1 * DEG2RAD, lon1 * DEG2RAD, lat2 * DEG2RAD, lon2 * DEG2RAD}};
+        ds[i].ref[ds[i].len++] = dist;
+    }
+    fclose(f);
+    return true;
+}
+
+// Run one method on one data set, print a table row, return false if out of bounds
+static bool bench(const DataSet *ds, const Method method, double *dist)
+{
+    // Timing: whole batches until MINTIME has passed
+    double sum = 0;
+    size_t reps = 0;
+    double t0 = now(), t1;
+    uint64_t c0 = cycles();
+    do {
+        distances(method, ds->seg, ds->len, dist, TOLERANCE);
+        sum += dist[reps % ds->len];
+        ++reps;
+    } while ((t1 = now()) - t0 < MINTIME);
+    uint64_t c1 = cycles();
+    double segs = (double)reps * ds->len;
+
+    // Iterations, outside of the timing
+    double itersum = 0;
+    int itermax = 0;
+    if (method == VINCENTY || method == KARNEY)
+        for (size_t i = 0; i < ds->len; ++i) {
+            int iter;
+            if (method == VINCENTY)
+                vincentyiter(ds->seg[i], &iter);
+            else
+                karneyiter(ds->seg[i], &iter);
+            itersum += iter;
+            if (iter > itermax)
+                itermax = iter;
+        }
+
+    // Accuracy against the reference
+    double maxabs = 0, maxrel = 0;
+    bool ok = true;
+    for (size_t i = 0; i < ds->len && !(ds->self && method == KARNEY); ++i) {
+        double err = fabs(dist[i] - ds->ref[i]);
+        if (err > maxabs)
+            maxabs = err;
+        if (ds->ref[i] > 0 && err / ds->ref[i] > maxrel)
+            maxrel = err / ds->ref[i];
+        if (err > bound(method, ds->ref[i]))
+            ok = false;
+    }
+
+    printf("%-12s %-10s %8zu %10.1f %10.0f", ds->name, methodname[method], ds->len,
+        (t1 - t0) * 1e9 / segs, (c1 - c0) / segs);
+    if (method == VINCENTY || method == KARNEY)
+        printf(" %6.1f %5d", itersum / ds->len, itermax);
+    else
+        printf(" %6s %5s", "-", "-");
+    if (ds->self && method == KARNEY)
+        printf(" %10s %10s  %s\n", "-", "-", "ref");
+    else
+        printf(" %10.3g %10.3g  %s\n", maxabs, maxrel, ok ? "ok" : "FAIL");
+    return ok || sum < 0;  // use sum so the timed loop is not optimised away
+}
+
+// Single precision path kernel on the points of a data set of consecutive segments
+static bool benchfloat(const DataSet *ds, const char *name,
+    void (*kernel)(const double, const float *, const float *, const size_t, float *), const Method method)
+{
+    size_t n = ds->len + 1;
+    double *lat = malloc(n * sizeof *lat), *lon = malloc(n * sizeof *lon);
+    float *dlat = malloc(n * sizeof *dlat), *dlon = malloc(n * sizeof *dlon), *dist = malloc(n * sizeof *dist);
+    if (!lat || !lon || !dlat || !dlon || !dist) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        lat[i] = (i ? ds->seg[i - 1].lat2 : ds->seg[0].lat1) / DEG2RAD;
+        lon[i] = (i ? ds->seg[i - 1].lon2 : ds->seg[0].lon1) / DEG2RAD;
+    }
+    double lat0, lon0;
+    relcoor(lat, lon, n, &lat0, &lon0, dlat, dlon);
+
+    double sum = 0;
+    size_t reps = 0;
+    double t0 = now(), t1;
+    uint64_t c0 = cycles();
+    do {
+        kernel(lat0, dlat, dlon, n, dist);
+        sum += dist[reps % n];
+        ++reps;
+    } while ((t1 = now()) - t0 < MINTIME);
+    uint64_t c1 = cycles();
+    double segs = (double)reps * ds->len;
+
+    // Documented bound of the double precision method plus FLOATERR
+    double maxabs = 0, maxrel = 0;
+    bool ok = true;
+    for (size_t i = 0; i < ds->len; ++i) {
+        double ref = ds->ref[i], err = fabs(dist[i + 1] - ref);
+        if (err > maxabs)
+            maxabs = err;
+        if (ref > 0 && err / ref > maxrel)
+            maxrel = err / ref;
+        if (err > bound(method, ref) + FLOATERR)
+            ok = false;
+    }
+    printf("%-12s %-10s %8zu %10.1f %10.0f %6s %5s %10.3g %10.3g  %s\n", ds->name, name, ds->len,
+        (t1 - t0) * 1e9 / segs, (c1 - c0) / segs, "-", "-", maxabs, maxrel, ok ? "ok" : "FAIL");
+    free(lat); free(lon); free(dlat); free(dlon); free(dist);
+    return ok || sum < 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *fname = argc > 1 ? argv[1] : "e3.gpx";
+    const char *refname = argc > 2 ? argv[2] : "geodesics.txt";
+    DataSet ds[DATASETS] = {
+        {.name = "gpx", .self = true},
+        {.name = "continental"}, {.name = "antipodal"}, {.name = "equatorial"}, {.name = "antimeridian"},
+    };
+    ds[0].len = readgpx(fname, &ds[0].seg);
+    if (!ds[0].len) {
+        fprintf(stderr, "No track points in %s.\n", fname);
+        return EXIT_FAILURE;
+    }
+    if (!(ds[0].ref = malloc(ds[0].len * sizeof *ds[0].ref))) {
+        fprintf(stderr, "Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+    distances(KARNEY, ds[0].seg, ds[0].len, ds[0].ref, TOLERANCE);
+    if (!readref(refname, ds + 1, DATASETS - 1)) {
+        fprintf(stderr, "Could not read %s.\n", refname);
+        return EXIT_FAILURE;
+    }
+
+    size_t maxlen = 0;
+    for (int i = 0; i < DATASETS; ++i)
+        if (ds[i].len > maxlen)
+            maxlen = ds[i].len;
+    double *dist = malloc(maxlen * sizeof *dist);
+    if (!dist) {
+        fprintf(stderr, "Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    printf("Reference geodesics:\n");
+    for (size_t i = 0; i < sizeof anchor / sizeof *anchor; ++i) {
+        LineSegment a = {{anchor[i].lat1 * DEG2RAD, anchor[i].lon1 * DEG2RAD,
+                          anchor[i].lat2 * DEG2RAD, anchor[i].lon2 * DEG2RAD}};
+        printf("  (%g,%g)-(%g,%g) %.6f:", anchor[i].lat1, anchor[i].lon1, anchor[i].lat2, anchor[i].lon2, anchor[i].dist);
+        for (Method m = 0; m < METHODS; ++m) {
+            distances(m, &a, 1, dist, TOLERANCE);
+            bool good = fabs(dist[0] - anchor[i].dist) <= bound(m, anchor[i].dist);
+            printf(" %s%s", methodname[m], good ? "" : "=FAIL");
+            ok &= good;
+        }
+        printf("\n");
+    }
+
+    printf("\n%-12s %-10s %8s %10s %10s %6s %5s %10s %10s\n",
+        "data", "method", "segments", "ns/seg", "cycles/seg", "iter", "max", "abs err m", "rel err");
+    for (int i = 0; i < DATASETS; ++i)
+        for (Method m = 0; m < METHODS && ds[i].len; ++m)
+            ok &= bench(&ds[i], m, dist);
+    ok &= benchfloat(&ds[0], "haversinef", haversinef, HAVERSINE);
+    ok &= benchfloat(&ds[0], "flatf", flatf, ADAPTIVE);
+
+    free(dist);
+    for (int i = 0; i < DATASETS; ++i) {
+        free(ds[i].seg);
+        free(ds[i].ref);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,401 @@
+/*****************************************************************************
+ * GPX PIPELINE BENCHMARK
+ * Times every stage of reading, retiming and rewriting a GPX file:
+ *
+ *     benchgpx [-n maxpoints] [-m method] [-d demdir] [file.gpx]
+ *
+ * First on the file itself (default e3.gpx), then on synthetic tracks of
+ * 10^5, 10^6, ... up to maxpoints points (default 10^6) made from the same
+ * track with perturbed coordinates and elevations. Stages:
+ *
+ *     read      file into memory
+ *     tokenize  find all trkpt elements without converting numbers
+ *     numbers   convert coordinates, elevation and time (= full parse - tokenize)
+ *     mapped    full parse through the memory mapped reader (= read + parse)
+ *     parallel  full parse of the buffer split in byte ranges, all processors
+ *     arena     mapped parse into a track in a reused arena, as a batch
+ *               worker does per file (no malloc in steady state)
+ *     distance  segment distances with the chosen method (default adaptive)
+ *               and timestamps at 40 km/h
+ *     retime    timestamps at 40 km/h from a parallel compensated prefix
+ *               sum of the distances, all processors
+ *     cumsum    fast compensated prefix sum of the distances, all processors
+ *     reprosum  reproducible prefix sum of the distances, all processors
+ *               (the overhead of reproducibility is reprosum - cumsum)
+ *     smooth    Savitzky-Golay elevation filter (half window 5) on a copy
+ *               of the elevations
+ *     dem       elevation of every point from the .hgt tiles in demdir, into
+ *               a copy of the elevations (only with -d; tiles stay mapped)
+ *     format    track to GPX text in memory
+ *     write     GPX text to file
+ *     pack      track to packed binary format in memory
+ *     unpack    packed binary format to track
+ *     polyenc   track to encoded polyline (precision 5)
+ *     polydec   encoded polyline to coordinates in blocks
+ *
+ * Output is one JSON object per line and stage, with the version of the
+ * source tree so results can be compared between versions.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>    // printf, fprintf, fopen, fwrite
+#include <stdlib.h>   // malloc, free, strtoull, mkstemp
+#include <string.h>   // strcmp, memcpy
+#include <stdint.h>   // uint64_t
+#include <time.h>     // clock_gettime
+#include <unistd.h>   // getopt, close, unlink
+#include "gpxio.h"
+#include "trackbin.h"
+#include "polyline.h"
+#include "input.h"
+#include "parallel.h"
+#include "smooth.h"
+#include "dem.h"
+
+#ifndef VERSION
+#define VERSION "unknown"
+#endif
+
+#define MINTIME   0.2             // seconds per measurement
+#define MINPOINTS 100000          // smallest synthetic track
+#define MAXPOINTS 1000000         // default largest synthetic track
+#define SPEED     (40 / 3.6)      // m/s
+#define START     1679652000000   // 2023-03-24T10:00:00Z in ms
+
+typedef struct {
+    const char *input;  // name of the data set
+    const char *fname;  // file to read
+    char outname[32];   // temporary output file
+    Method method;
+    char *buf;          // file contents
+    size_t size;
+    Track trk;
+    double *dist;
+    double *cum;
+    Arena arena;
+    Smoother smooth;
+    Dem dem;            // dem.dir = NULL: no tiles
+    TextBuffer out;
+    TextBuffer packed;
+    Track unpacked;
+    char *poly;         // encoded polyline
+    size_t polylen;
+} Bench;
+
+static uint64_t rng = 88172645463325252ULL;
+
+// Ref.: https://en.wikipedia.org/wiki/Xorshift
+static double uniform(const double min, const double max)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return min + (max - min) * (double)(rng >> 11) / (double)(1ULL << 53);
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void fail(const char *msg)
+{
+    fprintf(stderr, "%s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+static void stageread(Bench *b)
+{
+    free(b->buf);
+    if (!(b->buf = readfile(b->fname, &b->size)))
+        fail("Could not read input file.");
+}
+
+static void stagetokenize(Bench *b)
+{
+    GpxParser p;
+    gpxinit(&p, NULL);
+    gpxparse(&p, b->buf, b->size, true);
+}
+
+static void stageparse(Bench *b)
+{
+    GpxParser p;
+    trackclear(&b->trk);
+    gpxinit(&p, &b->trk);
+    gpxparse(&p, b->buf, b->size, true);
+    if (p.oom)
+        fail("Out of memory.");
+}
+
+static void stagemapped(Bench *b)
+{
+    trackclear(&b->trk);
+    if (!gpxread(b->fname, &b->trk))
+        fail("Could not read input file.");
+}
+
+static void stageparallel(Bench *b)
+{
+    trackclear(&b->trk);
+    if (!gpxparsemt(b->buf, b->size, 0, &b->trk))
+        fail("Out of memory.");
+}
+
+static void stagearena(Bench *b)
+{
+    arenareset(&b->arena);
+    Track t = {.arena = &b->arena};
+    if (!gpxread(b->fname, &t))
+        fail("Could not read input file.");
+}
+
+static void stagedistance(Bench *b)
+{
+    trackdistances(&b->trk, b->method, TOLERANCE, b->dist);
+    trackretime(&b->trk, b->dist, START, SPEED);
+}
+
+static void stageretime(Bench *b)
+{
+    if (!trackretimemt(&b->trk, b->dist, START, SPEED, 0))
+        fail("Out of memory.");
+}
+
+static void stagecumsum(Bench *b)
+{
+    prefixsum(b->dist, b->trk.len, b->cum, 0);
+}
+
+static void stagereprosum(Bench *b)
+{
+    if (!reprosum(b->dist, b->trk.len, b->cum, 0))
+        fail("Out of memory.");
+}
+
+static void stagesmooth(Bench *b)
+{
+    memcpy(b->cum, b->trk.ele, b->trk.len * sizeof *b->cum);
+    smoothpush(&b->smooth, b->cum, b->trk.len);
+    smoothflush(&b->smooth);
+}
+
+static void stagedem(Bench *b)
+{
+    Track t = b->trk;
+    t.ele = b->cum;
+    demtrack(&b->dem, &t, 0, t.len);
+}
+
+static void stageformat(Bench *b)
+{
+    b->out.len = 0;
+    if (!gpxformat(&b->trk, &b->out))
+        fail("Out of memory.");
+}
+
+static void stagewrite(Bench *b)
+{
+    FILE *f = fopen(b->outname, "wb");
+    if (!f || fwrite(b->out.buf, 1, b->out.len, f) != b->out.len || fclose(f))
+        fail("Could not write output file.");
+}
+
+static void stagepack(Bench *b)
+{
+    b->packed.len = 0;
+    if (!trackpack(&b->trk, &b->packed))
+        fail("Out of memory.");
+}
+
+static void stageunpack(Bench *b)
+{
+    trackclear(&b->unpacked);
+    if (trackunpack(b->packed.buf, b->packed.len, &b->unpacked) != UNPACK_OK)
+        fail("Could not unpack track.");
+}
+
+static void stagepolyenc(Bench *b)
+{
+    PolyState st;
+    polyinit(&st, POLYPRECISION);
+    b->polylen = polyencode(&st, b->trk.lat, b->trk.lon, b->trk.len, b->poly);
+}
+
+static void stagepolydec(Bench *b)
+{
+    enum { BATCH = 1024 };
+    int32_t lat[BATCH], lon[BATCH];
+    PolyState st;
+    polyinit(&st, POLYPRECISION);
+    const char *s = b->poly, *end = b->poly + b->polylen;
+    while (s < end)
+        if (polydecode(&st, &s, end, lat, lon, BATCH) < BATCH && s != end)
+            fail("Invalid polyline.");
+}
+
+// Average seconds per run of one stage, repeated until MINTIME has passed
+static double timeit(void (*stage)(Bench *), Bench *b)
+{
+    size_t reps = 0;
+    double t0 = now(), t;
+    do {
+        stage(b);
+        ++reps;
+    } while ((t = now() - t0) < MINTIME);
+    return t / reps;
+}
+
+static void report(const Bench *b, const char *stage, const double sec, const size_t bytes)
+{
+    printf("{\"version\":\"%s\",\"input\":\"%s\",\"method\":\"%s\",\"points\":%zu,\"bytes\":%zu,"
+        "\"stage\":\"%s\",\"seconds\":%.6g,\"mb_per_s\":%.6g,\"points_per_s\":%.6g}\n",
+        VERSION, b->input, methodname[b->method], b->trk.len, bytes,
+        stage, sec, sec > 0 ? bytes / sec * 1e-6 : 0, sec > 0 ? b->trk.len / sec : 0);
+}
+
+static void run(Bench *b)
+{
+    double tread = timeit(stageread, b);
+    double ttok = timeit(stagetokenize, b);
+    double tparse = timeit(stageparse, b);
+    double tmapped = timeit(stagemapped, b);
+    double tparallel = timeit(stageparallel, b);
+    double tarena = timeit(stagearena, b);
+    if (!(b->dist = realloc(b->dist, (b->trk.len + 1) * sizeof *b->dist)))
+        fail("Out of memory.");
+    double tdist = timeit(stagedistance, b);
+    double tretime = timeit(stageretime, b);
+    if (!(b->cum = realloc(b->cum, (b->trk.len + 1) * sizeof *b->cum)))
+        fail("Out of memory.");
+    double tcumsum = timeit(stagecumsum, b);
+    double treprosum = timeit(stagereprosum, b);
+    smoothinit(&b->smooth, SMOOTH_SG, 0);
+    double tsmooth = timeit(stagesmooth, b);
+    double tdem = b->dem.dir ? timeit(stagedem, b) : 0;
+    double tformat = timeit(stageformat, b);
+    double twrite = timeit(stagewrite, b);
+    double tpack = timeit(stagepack, b);
+    double tunpack = timeit(stageunpack, b);
+    if (!(b->poly = realloc(b->poly, b->trk.len * POLYMAXLEN + 1)))
+        fail("Out of memory.");
+    double tpolyenc = timeit(stagepolyenc, b);
+    double tpolydec = timeit(stagepolydec, b);
+
+    report(b, "read", tread, b->size);
+    report(b, "tokenize", ttok, b->size);
+    report(b, "numbers", tparse > ttok ? tparse - ttok : 0, b->size);
+    report(b, "mapped", tmapped, b->size);
+    report(b, "parallel", tparallel, b->size);
+    report(b, "arena", tarena, b->size);
+    report(b, "distance", tdist, b->trk.len * 2 * sizeof *b->trk.lat);
+    report(b, "retime", tretime, b->trk.len * sizeof *b->dist);
+    report(b, "cumsum", tcumsum, b->trk.len * sizeof *b->dist);
+    report(b, "reprosum", treprosum, b->trk.len * sizeof *b->dist);
+    report(b, "smooth", tsmooth, b->trk.len * sizeof *b->trk.ele);
+    if (b->dem.dir)
+        report(b, "dem", tdem, b->trk.len * 2 * sizeof *b->trk.lat);
+    report(b, "format", tformat, b->out.len);
+    report(b, "write", twrite, b->out.len);
+    report(b, "pack", tpack, b->packed.len);
+    report(b, "unpack", tunpack, b->packed.len);
+    report(b, "polyenc", tpolyenc, b->polylen);
+    report(b, "polydec", tpolydec, b->polylen);
+    fflush(stdout);
+}
+
+// Synthetic track of n points: the base track over and over again, shifted
+// north a little every lap, with noise on coordinates and elevation
+static void synthetic(const Track *base, const size_t n, Track *t)
+{
+    trackclear(t);
+    if (!trackreserve(t, n))
+        fail("Out of memory.");
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = i % base->len, lap = i / base->len;
+        trackpush(t,
+            base->lat[j] + toe7(lap * 1e-3 + uniform(-2e-5, 2e-5)),
+            base->lon[j] + toe7(uniform(-2e-5, 2e-5)),
+            (isnan(base->ele[j]) ? 0 : base->ele[j]) + uniform(-0.5, 0.5),
+            NOTIME);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxpoints = MAXPOINTS;
+    Method method = ADAPTIVE;
+    const char *demdir = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:d:")) != -1) {
+        switch (opt) {
+            case 'n':
+                maxpoints = strtoull(optarg, NULL, 10);
+                break;
+            case 'm':
+                for (method = 0; method < METHODS && strcmp(optarg, methodname[method]); ++method);
+                if (method == METHODS)
+                    fail("Unknown method.");
+                break;
+            case 'd':
+                demdir = optarg;
+                break;
+            default:
+                fail("Usage: benchgpx [-n maxpoints] [-m method] [-d demdir] [file.gpx]");
+        }
+    }
+    const char *fname = optind < argc ? argv[optind] : "e3.gpx";
+
+    Bench b = {.input = fname, .fname = fname, .method = method};
+    if (demdir && !demopen(&b.dem, demdir))
+        fail("Out of memory.");
+    strcpy(b.outname, "/tmp/benchgpx-out-XXXXXX");
+    int fd = mkstemp(b.outname);
+    if (fd == -1)
+        fail("Could not create temporary file.");
+    close(fd);
+    run(&b);
+    if (!b.trk.len)
+        fail("No track points in input file.");
+
+    // Synthetic tracks: write to a temporary file, then the same stages
+    Track base = {0}, syn = {0};
+    if (!trackreserve(&base, b.trk.len))
+        fail("Out of memory.");
+    for (size_t i = 0; i < b.trk.len; ++i)
+        trackpush(&base, b.trk.lat[i], b.trk.lon[i], b.trk.ele[i], NOTIME);
+    char inname[32] = "/tmp/benchgpx-in-XXXXXX";
+    if ((fd = mkstemp(inname)) == -1)
+        fail("Could not create temporary file.");
+    close(fd);
+    char label[32];
+    for (size_t n = MINPOINTS; n <= maxpoints; n *= 10) {
+        synthetic(&base, n, &syn);
+        if (!gpxwrite(inname, &syn))
+            fail("Could not write synthetic track.");
+        snprintf(label, sizeof label, "synthetic-%zu", n);
+        b.input = label;
+        b.fname = inname;
+        run(&b);
+    }
+    unlink(inname);
+    unlink(b.outname);
+
+    trackfree(&base);
+    trackfree(&syn);
+    trackfree(&b.trk);
+    trackfree(&b.unpacked);
+    free(b.buf);
+    free(b.dist);
+    free(b.cum);
+    arenafree(&b.arena);
+    demclose(&b.dem);
+    free(b.out.buf);
+    free(b.packed.buf);
+    free(b.poly);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/*****************************************************************************
+ * DIGITAL ELEVATION MODEL
+ * See dem.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>     // snprintf
+#include <stdlib.h>    // malloc, free
+#include <string.h>    // strlen, memcpy
+#include <math.h>      // NAN, isnan, sqrt
+#include <fcntl.h>     // open
+#include <unistd.h>    // close
+#include <sys/mman.h>  // mmap, munmap, madvise
+#include <sys/stat.h>  // fstat
+#include "dem.h"
+
+bool demopen(Dem *d, const char *dir)
+{
+    *d = (Dem){0};
+    const size_t len = strlen(dir);
+    if (!(d->dir = malloc(len + 1)))
+        return false;
+    memcpy(d->dir, dir, len + 1);
+    return true;
+}
+
+void demclose(Dem *d)
+{
+    for (int i = 0; i < d->ntiles; ++i)
+        if (d->tile[i].data)
+            munmap((void *)d->tile[i].data, d->tile[i].size);
+    free(d->dir);
+    *d = (Dem){0};
+}
+
+// Degree of the tile with the point: floor division of fixed point
+static int tiledeg(const int32_t x)
+{
+    return x >= 0 ? x / E7 : -(int)((-(int64_t)x + E7 - 1) / E7);
+}
+
+// Map tile file into t; t->data stays NULL if it does not exist or is not a square grid
+static void maptile(const Dem *d, DemTile *t)
+{
+    char path[4096];
+    snprintf(path, sizeof path, "%s/%c%02d%c%03d.hgt", d->dir,
+        t->lat < 0 ? 'S' : 'N', abs(t->lat), t->lon < 0 ? 'W' : 'E', abs(t->lon));
+    t->data = NULL;
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 8) {
+        const size_t size = (size_t)st.st_size;
+        const int side = (int)(sqrt((double)(size / 2)) + 0.5);
+        if ((size_t)side * (size_t)side * 2 == size) {
+            void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+#ifdef MADV_RANDOM
+                madvise(p, size, MADV_RANDOM);  // a track touches a few rows, not the whole tile
+#endif
+                t->data = p;
+                t->size = size;
+                t->side = side;
+            }
+        }
+    }
+    close(fd);
+}
+
+// Cached tile with south-west corner lat, lon; maps it (or finds it is
+// missing) on first use, unmapping the least recently used if full
+static const DemTile *gettile(Dem *d, const int lat, const int lon)
+{
+    d->clock++;
+    DemTile *t = NULL;
+    for (int i = 0; i < d->ntiles; ++i)
+        if (d->tile[i].lat == lat && d->tile[i].lon == lon) {
+            t = &d->tile[i];
+            t->used = d->clock;
+            return t;
+        }
+    if (d->ntiles < DEMTILES)
+        t = &d->tile[d->ntiles++];
+    else {
+        t = &d->tile[0];
+        for (int i = 1; i < DEMTILES; ++i)
+            if (d->tile[i].used < t->used)
+                t = &d->tile[i];
+        if (t->data)
+            munmap((void *)t->data, t->size);
+    }
+    t->lat = lat;
+    t->lon = lon;
+    t->used = d->clock;
+    maptile(d, t);
+    d->maps += t->data != NULL;
+    return t;
+}
+
+static inline int sample(const DemTile *t, const size_t i)
+{
+    return (int16_t)(t->data[2 * i] << 8 | t->data[2 * i + 1]);
+}
+
+// Elevations of n <= DEMBATCH points that are all on tile t, NAN where a
+// sample is missing
+static void tilebatch(const DemTile *t, const int32_t *lat, const int32_t *lon, const size_t n, double *ele)
+{
+    double fx[DEMBATCH], fy[DEMBATCH], v00[DEMBATCH], v01[DEMBATCH], v10[DEMBATCH], v11[DEMBATCH];
+    bool gap = false;
+    const int last = t->side - 2;
+    const double scale = (double)(t->side - 1) / E7;
+    const int64_t north = ((int64_t)t->lat + 1) * E7, west = (int64_t)t->lon * E7;
+
+    // Grid positions and samples of the corners around each point
+    for (size_t j = 0; j < n; ++j) {
+        const double y = (double)(north - lat[j]) * scale;
+        const double x = (double)(lon[j] - west) * scale;
+        int r = (int)y, c = (int)x;
+        if (r > last) r = last;
+        if (c > last) c = last;
+        fy[j] = y - r;
+        fx[j] = x - c;
+        const size_t i = (size_t)r * (size_t)t->side + (size_t)c;
+        const int a = sample(t, i), b = sample(t, i + 1);
+        const int e = sample(t, i + (size_t)t->side), f = sample(t, i + (size_t)t->side + 1);
+        gap |= a == DEMVOID || b == DEMVOID || e == DEMVOID || f == DEMVOID;
+        v00[j] = a; v01[j] = b; v10[j] = e; v11[j] = f;
+    }
+
+    // Bilinear interpolation
+    for (size_t j = 0; j < n; ++j) {
+        const double top = v00[j] + fx[j] * (v01[j] - v00[j]);
+        const double bot = v10[j] + fx[j] * (v11[j] - v10[j]);
+        ele[j] = top + fy[j] * (bot - top);
+    }
+    if (!gap)
+        return;
+
+    // Near missing samples: weights of the samples that are there
+    for (size_t j = 0; j < n; ++j) {
+        const double v[4] = {v00[j], v01[j], v10[j], v11[j]};
+        const double w[4] = {(1 - fx[j]) * (1 - fy[j]), fx[j] * (1 - fy[j]), (1 - fx[j]) * fy[j], fx[j] * fy[j]};
+        double sum = 0, wsum = 0;
+        bool any = false;
+        for (int k = 0; k < 4; ++k)
+            if (v[k] == DEMVOID)
+                any = true;
+            else {
+                sum += w[k] * v[k];
+                wsum += w[k];
+            }
+        if (any)
+            ele[j] = wsum > 0 ? sum / wsum : NAN;
+    }
+}
+
+double demele(Dem *d, const int32_t lat, const int32_t lon)
+{
+    if (lat == NOCOOR || lon == NOCOOR)
+        return NAN;
+    const DemTile *t = gettile(d, tiledeg(lat), tiledeg(lon));
+    if (!t->data)
+        return NAN;
+    double ele;
+    tilebatch(t, &lat, &lon, 1, &ele);
+    return ele;
+}
+
+size_t demtrack(Dem *d, Track *t, const size_t first, const size_t n)
+{
+    size_t count = 0;
+    double ele[DEMBATCH];
+    const size_t end = first + n;
+    for (size_t i = first; i < end; ) {
+        if (t->lat[i] == NOCOOR || t->lon[i] == NOCOOR) {
+            ++i;
+            continue;
+        }
+        // Run of consecutive points on one tile
+        const int lat = tiledeg(t->lat[i]), lon = tiledeg(t->lon[i]);
+        size_t k = i + 1;
+        while (k < end && k - i < DEMBATCH && t->lat[k] != NOCOOR && t->lon[k] != NOCOOR
+            && tiledeg(t->lat[k]) == lat && tiledeg(t->lon[k]) == lon)
+            ++k;
+        const DemTile *tile = gettile(d, lat, lon);
+        if (tile->data) {
+            tilebatch(tile, t->lat + i, t->lon + i, k - i, ele);
+            for (size_t j = i; j < k; ++j)
+                if (!isnan(ele[j - i])) {
+                    t->ele[j] = ele[j - i];
+                    ++count;
+                }
+        }
+        i = k;
+    }
+    return count;
+}
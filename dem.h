@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * DIGITAL ELEVATION MODEL
+ * Elevation of track points from SRTM style .hgt tiles in a local directory:
+ * one file per degree, named after its south-west corner (N50E003.hgt,
+ * S23W044.hgt), with a square grid of big-endian 16-bit heights in metres,
+ * rows from north to south, 1201 x 1201 (3") or 3601 x 3601 (1") samples;
+ * -32768 is no data. Edges are shared with the neighbouring tiles.
+ *
+ * Tiles are memory mapped when first needed and kept in a small cache; when
+ * it is full the least recently used tile is unmapped. Missing tiles are
+ * remembered too, so the file system is asked only once. Points are looked
+ * up in batches of consecutive points on the same tile: grid positions and
+ * the four samples first, then the bilinear interpolation for the whole
+ * batch in one loop the compiler vectorises.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef DEM_H_
+#define DEM_H_
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int32_t, int16_t, uint64_t
+#include <stdbool.h>  // bool
+#include "track.h"
+
+#define DEMTILES 16      // tiles in the cache
+#define DEMBATCH 256     // points per interpolation batch
+#define DEMVOID  -32768  // sample without data
+
+typedef struct {
+    int lat, lon;          // south-west corner in degrees
+    const uint8_t *data;   // mapped file, NULL if there is no tile
+    size_t size;
+    int side;              // samples per row and column
+    uint64_t used;         // clock of the last lookup
+} DemTile;
+
+typedef struct {
+    char *dir;             // tile directory
+    DemTile tile[DEMTILES];
+    int ntiles;
+    uint64_t clock;
+    size_t maps;           // tiles mapped so far, for statistics
+} Dem;
+
+// Tiles from directory dir, false if out of memory. Nothing is opened yet.
+bool demopen(Dem *d, const char *dir);
+
+// Unmap all tiles and release memory
+void demclose(Dem *d);
+
+// Elevation at a point, NAN if there is no tile or no data
+double demele(Dem *d, const int32_t lat, const int32_t lon);
+
+// Replace the elevation of points [first, first + n) by that of the model
+// where it has data, others keep theirs; returns the number replaced
+size_t demtrack(Dem *d, Track *t, const size_t first, const size_t n);
+
+#endif
@@ -13,7 +13,9 @@ RADIUS_EQUATORIAL_SQUARED = RADIUS_EQUATORIAL * RADIUS_EQUATORIAL
 def isequal(a, b):
     return fabs(a - b) < EPSILON
 
-def earth_diameter(latdeg):
+DIAMETER_STEP = 0.5  # degrees latitude between table entries, max interpolation error ~0.8 m
+
+def earth_diameter_exact(latdeg):
     if isequal(latdeg, 0):
         return 2 * RADIUS_EQUATORIAL
     if isequal(latdeg, 90) or isequal(latdeg, -90):
@@ -27,6 +29,15 @@ def earth_diameter(latdeg):
     denom = radius_sin_sqr + radius_cos_sqr
     return 2 * sqrt(numer / denom)
 
+DIAMETER_TABLE = [earth_diameter_exact(i * DIAMETER_STEP) for i in range(int(90 / DIAMETER_STEP) + 1)]
+
+def earth_diameter(latdeg):
+    x = fabs(latdeg) / DIAMETER_STEP
+    i = int(x)
+    if i >= len(DIAMETER_TABLE) - 1:
+        return DIAMETER_TABLE[-1]
+    return DIAMETER_TABLE[i] + (x - i) * (DIAMETER_TABLE[i + 1] - DIAMETER_TABLE[i])
+
 def distance(p1, p2):
     dlat = p2['lat'] - p1['lat']
     dlon = p2['lon'] - p1['lon']
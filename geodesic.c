@@ -0,0 +1,576 @@
+/*****************************************************************************
+ * GEODESIC DISTANCE KERNELS
+ * See geodesic.h for the methods and their error bounds.
+ *
+ * The local radius of the haversine method is the geocentric radius, which is
+ * too large for north-south segments near the equator; at mid latitudes it is
+ * usually better than the mean radius. Vincenty does not converge for nearly
+ * antipodal points; those are handed over to Karney's method. The adaptive
+ * method is meant for GPS tracks where nearly all segments are a few metres
+ * long: it uses a local scale that is only recomputed when the latitude moves
+ * more than LATSPAN, and no trigonometry at all for segments within tolerance.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <math.h>     // sin, cos, asin, sqrt, cbrt, atan2, hypot, fabs
+#include <float.h>    // DBL_EPSILON
+#include <stdbool.h>  // bool
+#include "geodesic.h"
+
+// WGS-84 constants
+#define RA   6.378137e+6      // earth equatorial radius in metres
+#define FINV 298.257223563    // 1/f = inverse flattening of the ellipsoid
+
+// WGS-84 derived constants
+#define F   (1.0 / FINV)      // f    ~= 0.00335
+#define F1  (1.0 - F)         // 1-f  ~= 0.9966
+#define F16 (F / 16.0)        // f/16 ~= 0.00021
+#define RB  (RA * F1)         // earth polar radius in metres
+#define R1  ((2 * RA + RB) / 3)  // mean radius in metres
+#define A2  (RA * RA)         // square equatorial radius
+#define B2  (RB * RB)         // square polar radius
+#define RF  ((A2 - B2) / B2)  // reduced a/b fraction = second eccentricity squared
+#define E2  ((A2 - B2) / A2)  // first eccentricity squared
+#define F3  (F / (2 - F))     // n = third flattening
+
+#define EPSILON 1e-12           // equality of coordinates and convergence of Vincenty
+#define MAXITER 200             // Karney iterations before giving up
+#define NEWTON 20               // Newton steps of Karney's method before only bisecting
+#define TINY 1.4916681462400413e-154  // sqrt(DBL_MIN), keeps the azimuth bracket off 0 and pi
+#define TOLB (DBL_EPSILON * 1.4901161193847656e-08)  // bracket width at which bisection stops
+#define LATSPAN 1e-3            // max latitude difference in radians from reference of local scale
+#define VINCITER 50             // Vincenty iterations before handing over to Karney
+#define RADSTEPS 180            // local radius table intervals from equator to pole (0.5 degree)
+
+const char *const methodname[METHODS] = {"spherical", "haversine", "adaptive", "vincenty", "karney"};
+
+static inline bool equal(const double a, const double b)
+{
+    return fabs(a - b) <= EPSILON;
+}
+
+// Local earth radius in metres at latitude 0..90 degrees in steps of 90/RADSTEPS,
+// filled once at load time so that threads only ever read it
+static double radius[RADSTEPS + 1];
+
+// Gauss-Legendre quadrature, 16 points on [-1,1]: positive half of the symmetric nodes and weights
+static const double glnode[8] = {
+    0.095012509837637441, 0.28160355077925892, 0.45801677765722737, 0.61787624440264377,
+    0.755404408355003,    0.86563120238783176, 0.9445750230732326,  0.98940093499164994};
+static const double glweight[8] = {
+    0.18945061045506847, 0.18260341504492361, 0.16915651939500256, 0.14959598881657682,
+    0.12462897125553395, 0.095158511682492897, 0.062253523938647776, 0.027152459411754058};
+
+// Central angle in radians between two points on a sphere
+// Ref.: https://en.wikipedia.org/wiki/Haversine_formula#Formulation
+static double centralangle(const LineSegment a)
+{
+    double slat = sin((a.lat2 - a.lat1) / 2);
+    double slon = sin((a.lon2 - a.lon1) / 2);
+    return 2 * asin(sqrt(slat * slat + cos(a.lat1) * cos(a.lat2) * slon * slon));
+}
+
+// Great-circle distance on a sphere with the mean earth radius
+double spherical(const LineSegment a)
+{
+    return R1 * centralangle(a);
+}
+
+// Geocentric earth radius in metres at latitude in radians
+// Ref.: https://en.wikipedia.org/wiki/Earth_radius#Location-dependent_radii
+static double localradius(const double lat)
+{
+    double s = sin(lat);
+    double c = cos(lat);
+    double rs = B2 * s * s;
+    double rc = A2 * c * c;
+    return sqrt((B2 * rs + A2 * rc) / (rs + rc));
+}
+
+__attribute__((constructor)) static void initradius(void)
+{
+    for (int i = 0; i <= RADSTEPS; ++i)
+        radius[i] = localradius(i * (M_PI / 2 / RADSTEPS));
+}
+
+// Local earth radius by linear interpolation in the table. The radius is about
+// a - (a - b) sin^2(lat) so |R''| <= 2(a - b) and the interpolation error is at
+// most h^2 (a - b) / 4 = 0.41 m for h = 0.5 degree, or 6.4e-8 relative.
+static double tableradius(const double lat)
+{
+    double x = fabs(lat) * (RADSTEPS / (M_PI / 2));
+    int i = (int)x;
+    if (i >= RADSTEPS)
+        return radius[RADSTEPS];
+    return radius[i] + (x - i) * (radius[i + 1] - radius[i]);
+}
+
+// Great-circle distance on a sphere with the local earth radius at the average latitude
+// Ref.: https://en.wikipedia.org/wiki/Great-circle_distance#Computational_formulas
+double haversine(const LineSegment a)
+{
+    return tableradius((a.lat1 + a.lat2) / 2) * centralangle(a);
+}
+
+// Integrals on the auxiliary sphere from sigma1 to sigma2 with k2 = k^2 = e'^2 cos^2(alpha0)
+//   i1 = integral of sqrt(1 + k^2 sin^2(sigma)) = distance / b
+//   i3 = integral of (2 - f) / (1 + (1 - f) sqrt(1 + k^2 sin^2(sigma)))
+//   j  = integral of sqrt(1 + k^2 sin^2(sigma)) - 1 / sqrt(1 + k^2 sin^2(sigma))
+// Panels of at most pi/2 keep 16-point quadrature exact to double precision.
+static void integrals(const double sigma1, const double sigma2, const double k2,
+    double *i1, double *i3, double *j)
+{
+    int panels = (int)ceil((sigma2 - sigma1) / (M_PI / 2));
+    if (panels < 1)
+        panels = 1;
+    double h = (sigma2 - sigma1) / (2 * panels);  // half panel width
+    double sum1 = 0, sum3 = 0, sumj = 0;
+    for (int i = 0; i < panels; ++i) {
+        double mid = sigma1 + (2 * i + 1) * h;
+        for (int k = 0; k < 8; ++k)
+            for (int sign = -1; sign <= 1; sign += 2) {
+                double s = sin(mid + sign * h * glnode[k]);
+                double t = sqrt(1 + k2 * s * s);
+                sum1 += glweight[k] * t;
+                sum3 += glweight[k] * (2 - F) / (1 + F1 * t);
+                sumj += glweight[k] * (t - 1 / t);
+            }
+    }
+    *i1 = sum1 * h;
+    *i3 = sum3 * h;
+    *j = sumj * h;
+}
+
+// Geodesic from point 1 with azimuth alpha1
+typedef struct {
+    double eta;    // lambda12(alpha1) minus the wanted lambda12, radians
+    double dv;     // derivative of eta to alpha1
+    double sig12;  // arc length on the auxiliary sphere
+    double m12;    // reduced length in metres
+    double dist;   // length in metres
+} Geodesic;
+
+// Geodesic between reduced latitudes beta1 and beta2 (as sin,cos) with azimuth
+// alpha1 (as sin,cos) at point 1, compared to longitude difference lambda12
+// (as sin,cos). Requires beta1 <= 0 and |beta1| >= |beta2| so that point 2 is
+// reached heading north. Karney eqs. (5)-(8), (38) and (41).
+static Geodesic geodesic(const double sb1, const double cb1, const double sb2, const double cb2,
+    const double sa1, const double ca1, const double slam, const double clam)
+{
+    double sa0 = sa1 * cb1;                  // Clairaut: sin(alpha0) = sin(alpha1) cos(beta1)
+    double ca0 = hypot(ca1, sa1 * sb1);
+    // cos(alpha2) cos(beta2) without cancellation when the latitudes are close
+    double ca2cb2 = cb2 != cb1 || fabs(sb2) != -sb1
+        ? sqrt(ca1 * ca1 * cb1 * cb1 + (cb1 < -sb1 ? (cb2 - cb1) * (cb1 + cb2) : (sb1 - sb2) * (sb1 + sb2)))
+        : fabs(ca1) * cb1;
+
+    // Arc lengths sigma and longitudes omega on the auxiliary sphere
+    double n1 = hypot(sb1, ca1 * cb1), n2 = hypot(sb2, ca2cb2);
+    double ss1 = sb1 / n1, cs1 = ca1 * cb1 / n1;
+    double ss2 = sb2 / n2, cs2 = ca2cb2 / n2;
+    double sigma1 = atan2(ss1, cs1);
+    double sig12 = atan2(fmax(0, cs1 * ss2 - ss1 * cs2), cs1 * cs2 + ss1 * ss2);
+    double so1 = sa0 * sb1, co1 = ca1 * cb1, so2 = sa0 * sb2, co2 = ca2cb2;
+    double somg = fmax(0, co1 * so2 - so1 * co2), comg = co1 * co2 + so1 * so2;
+    double eta = atan2(somg * clam - comg * slam, comg * clam + somg * slam);  // omega12 - lambda12
+
+    double k2 = RF * ca0 * ca0, i1, i3, j;
+    integrals(sigma1, sigma1 + sig12, k2, &i1, &i3, &j);
+    double w1 = sqrt(1 + k2 * ss1 * ss1), w2 = sqrt(1 + k2 * ss2 * ss2);
+    double m12b = w2 * cs1 * ss2 - w1 * ss1 * cs2 - cs1 * cs2 * j;
+    return (Geodesic){
+        .eta = eta - F * sa0 * i3,
+        .dv = ca2cb2 != 0 ? F1 * m12b / ca2cb2 : -2 * F1 * sqrt(1 + RF * sb1 * sb1) / sb1,
+        .sig12 = sig12,
+        .m12 = RB * m12b,
+        .dist = RB * i1,
+    };
+}
+
+// Positive root k of k^4 + 2k^3 - (x^2 + y^2 - 1)k^2 - 2y^2 k - y^2 = 0, Karney eq. (55)
+static double astroid(const double x, const double y)
+{
+    double p = x * x, q = y * y, r = (p + q - 1) / 6;
+    if (q == 0 && r <= 0)
+        return 0;
+    double S = p * q / 4, r2 = r * r, r3 = r * r2;
+    double disc = S * (S + 2 * r3);
+    double u = r;
+    if (disc >= 0) {
+        double T3 = S + r3;
+        T3 += T3 < 0 ? -sqrt(disc) : sqrt(disc);
+        double T = cbrt(T3);
+        u += T + (T != 0 ? r2 / T : 0);
+    } else
+        u += 2 * r * cos(atan2(sqrt(-disc), -(S + r3)) / 3);
+    double v = sqrt(u * u + q);
+    double uv = u < 0 ? q / (v - u) : u + v;
+    double w = (uv - q) / (2 * v);
+    return uv / (sqrt(uv + w * w) + w);
+}
+
+// Ellipsoidal distance for all pairs of points, including nearly antipodal ones.
+// Same formulation as Karney with numerical quadrature instead of series
+// expansions: Newton's method on the azimuth alpha1, kept as sin,cos so that
+// azimuths within 1e-16 of east stay exact for nearly equatorial pairs, from
+// his starting guesses and with bisection in a bracket as a fallback.
+// Ref.: C.F.F. Karney, Algorithms for geodesics, J. Geodesy 87 (2013) 43-55,
+//       https://doi.org/10.1007/s00190-012-0578-z
+double karneyiter(const LineSegment a, int *iter)
+{
+    *iter = 0;
+    if (equal(a.lat1, a.lat2) && equal(a.lon1, a.lon2))
+        return 0;
+
+    // Canonical order: lambda12 in [0,pi], point 1 southern-most and furthest from the equator
+    double lambda12 = fabs(remainder(a.lon2 - a.lon1, 2 * M_PI));
+    double slam = lambda12 == M_PI ? 0 : sin(lambda12), clam = cos(lambda12);
+    double lat1 = a.lat1, lat2 = a.lat2;
+    if (fabs(lat1) < fabs(lat2)) {
+        double t = lat1; lat1 = lat2; lat2 = t;
+    }
+    if (lat1 > 0) {
+        lat1 = -lat1;
+        lat2 = -lat2;
+    }
+
+    // Along the equator up to the point where the geodesic starts to cross the poles
+    if (lat1 == 0 && lambda12 <= F1 * M_PI)
+        return RA * lambda12;
+
+    // Reduced latitudes: tan(beta) = (1 - f) tan(phi)
+    double sb1 = F1 * sin(lat1), cb1 = cos(lat1), n1 = hypot(sb1, cb1);
+    double sb2 = F1 * sin(lat2), cb2 = cos(lat2), n2 = hypot(sb2, cb2);
+    sb1 /= n1; cb1 = fmax(TINY, cb1 / n1);
+    sb2 /= n2; cb2 = fmax(TINY, cb2 / n2);
+    if (cb1 < -sb1) {
+        if (cb2 == cb1)
+            sb2 = copysign(sb1, sb2);
+    } else if (fabs(sb2) == -sb1)
+        cb2 = cb1;
+
+    // Along the meridian of point 2, if that is the shortest way
+    Geodesic g;
+    if (slam == 0) {
+        *iter = 1;
+        g = geodesic(sb1, cb1, sb2, cb2, slam, clam, slam, clam);
+        if (g.sig12 < 1 || g.m12 >= 0)
+            return g.dist;
+    }
+
+    // Starting guess from the sphere with the longitude scaled at the mean latitude
+    double sb12 = sb2 * cb1 - cb2 * sb1, cb12 = cb2 * cb1 + sb2 * sb1;
+    double sb12a = sb2 * cb1 + cb2 * sb1;
+    double somg = slam, comg = clam;
+    if (cb12 >= 0 && sb12 < 0.5 && cb2 * lambda12 < 0.5) {  // short line
+        double s = sb1 + sb2, c = cb1 + cb2;
+        double omg = lambda12 / (F1 * sqrt(1 + RF * s * s / (s * s + c * c)));
+        somg = sin(omg);
+        comg = cos(omg);
+    }
+    double sa1 = cb2 * somg;
+    double ca1 = comg >= 0 ? sb12 + cb2 * sb1 * somg * somg / (1 + comg)
+                           : sb12a - cb2 * sb1 * somg * somg / (1 - comg);
+    double ssig12 = hypot(sa1, ca1), csig12 = sb1 * sb2 + cb1 * cb2 * comg;
+    if (csig12 < 0 && ssig12 < 6 * F3 * M_PI * cb1 * cb1) {
+        // Nearly antipodal: coordinates x, y scaled around the antipode of
+        // point 1, where the geodesics from point 1 meet; Karney section 6
+        double k2 = RF * sb1 * sb1, eps = k2 / (2 * (1 + sqrt(1 + k2)) + k2);
+        double lamscale = F * cb1 * (1 - (1 - F3) / 2 * eps) * M_PI;  // A3 to first order
+        double x = atan2(-slam, -clam) / lamscale;  // (lambda12 - pi) / lamscale
+        double y = sb12a / (lamscale * cb1);
+        if (y > -200 * DBL_EPSILON && x > -1 - 1000 * sqrt(DBL_EPSILON)) {
+            sa1 = fmin(1, -x);
+            ca1 = -sqrt(1 - sa1 * sa1);
+        } else {
+            double k = astroid(x, y);
+            double omg = lamscale * -x * k / (1 + k);
+            somg = sin(omg);
+            comg = -cos(omg);
+            sa1 = cb2 * somg;
+            ca1 = sb12a - cb2 * sb1 * somg * somg / (1 - comg);
+        }
+    }
+    double n = hypot(sa1, ca1);
+    sa1 /= n; ca1 /= n;
+
+    // Newton's method, bisection if a step leaves the bracket or after NEWTON steps
+    double sa1a = TINY, ca1a = 1, sa1b = TINY, ca1b = -1;  // alpha1 just above 0 and below pi
+    bool tripn = false, tripb = false;
+    for (int i = 1;; ++i) {
+        g = geodesic(sb1, cb1, sb2, cb2, sa1, ca1, slam, clam);
+        ++*iter;
+        if (tripb || !(fabs(g.eta) >= (tripn ? 8 : 1) * DBL_EPSILON) || i == MAXITER)
+            break;
+        if (g.eta > 0 && (i > NEWTON || ca1 / sa1 > ca1b / sa1b)) {
+            sa1b = sa1; ca1b = ca1;
+        } else if (g.eta < 0 && (i > NEWTON || ca1 / sa1 < ca1a / sa1a)) {
+            sa1a = sa1; ca1a = ca1;
+        }
+        if (i <= NEWTON && g.dv > 0) {
+            double d = -g.eta / g.dv;
+            if (fabs(d) < M_PI) {
+                double sd = sin(d), cd = cos(d), ns = sa1 * cd + ca1 * sd;
+                if (ns > 0) {
+                    ca1 = ca1 * cd - sa1 * sd;
+                    sa1 = ns;
+                    n = hypot(sa1, ca1);
+                    sa1 /= n; ca1 /= n;
+                    tripn = fabs(g.eta) <= 16 * DBL_EPSILON;
+                    continue;
+                }
+            }
+        }
+        sa1 = (sa1a + sa1b) / 2;
+        ca1 = (ca1a + ca1b) / 2;
+        n = hypot(sa1, ca1);
+        sa1 /= n; ca1 /= n;
+        tripn = false;
+        tripb = fabs(sa1a - sa1) + (ca1a - ca1) < TOLB || fabs(sa1 - sa1b) + (ca1 - ca1b) < TOLB;
+    }
+    return g.dist;
+}
+
+double karney(const LineSegment a)
+{
+    int iter;
+    return karneyiter(a, &iter);
+}
+
+// Ref.: https://en.wikipedia.org/wiki/Vincenty%27s_formulae
+double vincentyiter(const LineSegment a, int *iter)
+{
+    *iter = 0;
+    if (equal(a.lat1, a.lat2) && equal(a.lon1, a.lon2))
+        return 0;
+
+    double U1 = atan(F1 * tan(a.lat1));
+    double U2 = atan(F1 * tan(a.lat2));
+    double L = a.lon2 - a.lon1;
+    if (L > M_PI)
+        L -= 2 * M_PI;
+    else if (L < -M_PI)
+        L += 2 * M_PI;
+    double l = L, l0, ss, cs, s, c2a, c2sm;
+    do {
+        l0 = l;
+        double sU1 = sin(U1), cU1 = cos(U1);
+        double sU2 = sin(U2), cU2 = cos(U2);
+        double sl  = sin(l),  cl  = cos(l);
+        double sU12 = sU1 * sU2, cU12 = cU1 * cU2;
+
+        double p = cU2 * sl;
+        double q = cU1 * sU2 - sU1 * cU2 * cl;
+        ss = sqrt(p * p + q * q);
+        cs = sU12 + cU12 * cl;
+        s = atan2(ss, cs);
+        double sa = cU12 * sl / ss;
+        c2a = 1 - sa * sa;
+        c2sm = c2a != 0 ? cos(s) - 2 * sU12 / c2a : 0;  // 0 on the equator
+        double C = F16 * c2a * (4 + F * (4 - 3 * c2a));
+        l = L + (1 - C) * F * sa * (s + C * ss * (c2sm + C * cs * (-1 + 2 * c2sm * c2sm)));
+        // Nearly antipodal points: lambda runs past pi, or converges too slowly
+        if (!(fabs(l) <= M_PI) || ++*iter >= VINCITER) {
+            double dist = karneyiter(a, iter);
+            *iter += MAXITER;
+            return dist;
+        }
+    } while (!equal(l, l0));
+    double u2 = c2a * RF;
+    double t = sqrt(1 + u2);
+    double k1 = (t - 1) / (t + 1);
+    double k24 = 0.25 * k1 * k1;
+    // double A = 1 + (u2 / 16384) * (4096 + u2 * (-768 + u2 * (320 - 175 * u2)));
+    // double B = (u2 / 1024) * (256 + u2 * (-128 + u2 * (74 - 47 * u2)));
+    double A = (1 + k24) / (1 - k1);
+    double B = k1 * (1 - 1.5 * k24);
+    double ds = B * ss * (c2sm + (B / 4) * (cs * (-1 + 2 * c2sm * c2sm) - (B / 6) * c2sm * (-3 + 4 * ss * ss) * (-3 + 4 * c2sm * c2sm)));
+    return RB * A * (s - ds);
+}
+
+double vincenty(const LineSegment a)
+{
+    int iter;
+    return vincentyiter(a, &iter);
+}
+
+// Local scale from radii of curvature in the meridian (M) and the prime vertical (N)
+// Ref.: https://en.wikipedia.org/wiki/Earth_radius#Radii_of_curvature
+static void setscale(FlatScale *sc, const double lat)
+{
+    double s = sin(lat), c = cos(lat);
+    double w2 = 1 - E2 * s * s;
+    double N = RA / sqrt(w2);
+    double M = N * (1 - E2) / w2;
+    sc->lat = lat;
+    sc->kx = N * c;
+    sc->ky = M;
+    sc->dkx = N * s * (E2 * c * c / w2 - 1);
+    sc->dky = 3 * M * E2 * s * c / w2;
+    sc->t2 = 1 + 2 * s * s / (c * c);
+}
+
+// Equirectangular distance with the local scale at the average latitude if the
+// estimated error is within tolerance (metres), otherwise Vincenty. The flat-earth
+// error is about d^3 tan^2(lat) / 24R^2, plus d dlat^2 from the linearised scale.
+// Ref.: https://en.wikipedia.org/wiki/Geographical_distance#Ellipsoidal_Earth_projected_to_a_plane
+double adaptive(const LineSegment a, FlatScale *sc, const double tol)
+{
+    double lat = (a.lat1 + a.lat2) / 2;
+    double dl = lat - sc->lat;
+    if (!(fabs(dl) <= LATSPAN)) {  // also true for NAN = first call
+        setscale(sc, lat);
+        dl = 0;
+    }
+    double dlon = a.lon2 - a.lon1;
+    if (dlon > M_PI)
+        dlon -= 2 * M_PI;
+    else if (dlon < -M_PI)
+        dlon += 2 * M_PI;
+    double x = (sc->kx + sc->dkx * dl) * dlon;
+    double y = (sc->ky + sc->dky * dl) * (a.lat2 - a.lat1);
+    double d2 = x * x + y * y;
+    double d = sqrt(d2);
+    if (d * (dl * dl + sc->t2 * d2 / (24 * B2)) > tol)
+        return vincenty(a);
+    return d;
+}
+
+// Distances in metres of n line segments, all with the same method. Tolerance
+// in metres is only used by the adaptive method. One loop per method so every
+// kernel is inlined and nothing else is computed.
+void distances(const Method method, const LineSegment *seg, const size_t n, double *dist, const double tol)
+{
+    FlatScale sc = {.lat = NAN};
+    switch (method) {
+        case SPHERICAL: for (size_t i = 0; i < n; ++i) dist[i] = spherical(seg[i]); break;
+        case HAVERSINE: for (size_t i = 0; i < n; ++i) dist[i] = haversine(seg[i]); break;
+        case ADAPTIVE:  for (size_t i = 0; i < n; ++i) dist[i] = adaptive(seg[i], &sc, tol); break;
+        case VINCENTY:  for (size_t i = 0; i < n; ++i) dist[i] = vincenty(seg[i]);  break;
+        case KARNEY:    for (size_t i = 0; i < n; ++i) dist[i] = karney(seg[i]);    break;
+        default: break;
+    }
+}
+
+// Single precision kernels ///////////////////////////////////////////////////
+
+// Latitude dependent factors are quadratics in the latitude offset from the
+// middle of a block: f(mid + x) ~= c0 + x (c1 + x c2), fitted through mid and
+// mid +/- half the latitude span of the block. Error ~ f''' h^3 / 15, about
+// 1e-5 relative for h = SPANF; wider blocks fall back to exact factors.
+#define BLOCKF 1024  // points per block
+#define SPANF  0.05  // max half latitude span in radians of a block for the quadratic
+
+typedef struct {
+    float c0, c1, c2;
+} Quadratic;
+
+static double flatkx(const double lat)
+{
+    FlatScale sc;
+    setscale(&sc, lat);
+    return sc.kx;
+}
+
+static double flatky(const double lat)
+{
+    FlatScale sc;
+    setscale(&sc, lat);
+    return sc.ky;
+}
+
+static Quadratic quadfit(double (*f)(double), const double mid, const double h)
+{
+    double y0 = f(mid - h), y1 = f(mid), y2 = f(mid + h);
+    return (Quadratic){(float)y1, (float)((y2 - y0) / (2 * h)), (float)((y2 - 2 * y1 + y0) / (2 * h * h))};
+}
+
+static inline float quad(const Quadratic q, const float x)
+{
+    return q.c0 + x * (q.c1 + x * q.c2);
+}
+
+// Middle and half span of latitude offsets of points first..last (inclusive)
+static void blockspan(const float *dlat, const size_t first, const size_t last, float *mid, double *h)
+{
+    float min = dlat[first], max = dlat[first];
+    for (size_t i = first + 1; i <= last; ++i) {
+        if (dlat[i] < min) min = dlat[i];
+        if (dlat[i] > max) max = dlat[i];
+    }
+    *mid = (min + max) / 2;
+    *h = (max - min) / 2 > 1e-6 ? (max - min) / 2 : 1e-6;
+}
+
+void relcoor(const double *lat, const double *lon, const size_t n,
+    double *lat0, double *lon0, float *dlat, float *dlon)
+{
+    *lat0 = n ? lat[0] * DEG2RAD : 0;
+    *lon0 = n ? lon[0] * DEG2RAD : 0;
+    for (size_t i = 0; i < n; ++i) {
+        dlat[i] = (float)(lat[i] * DEG2RAD - *lat0);
+        dlon[i] = (float)remainder(lon[i] * DEG2RAD - *lon0, 2 * M_PI);
+    }
+}
+
+void haversinef(const double lat0, const float *dlat, const float *dlon, const size_t n, float *dist)
+{
+    if (!n)
+        return;
+    dist[0] = 0;
+    for (size_t first = 1; first < n; first += BLOCKF) {
+        size_t last = n - first < BLOCKF ? n - 1 : first + BLOCKF - 1;
+        float mid;
+        double h;
+        blockspan(dlat, first - 1, last, &mid, &h);
+        if (h > SPANF) {
+            for (size_t i = first; i <= last; ++i) {
+                double lat1 = lat0 + dlat[i - 1], lat2 = lat0 + dlat[i];
+                float s1 = sinf((dlat[i] - dlat[i - 1]) / 2), s2 = sinf((dlon[i] - dlon[i - 1]) / 2);
+                dist[i] = (float)tableradius((lat1 + lat2) / 2) * 2
+                    * asinf(sqrtf(s1 * s1 + (float)(cos(lat1) * cos(lat2)) * s2 * s2));
+            }
+            continue;
+        }
+        Quadratic r = quadfit(localradius, lat0 + mid, h);
+        Quadratic c = quadfit(cos, lat0 + mid, h);
+        for (size_t i = first; i <= last; ++i) {
+            float x1 = dlat[i - 1] - mid, x2 = dlat[i] - mid;
+            float s1 = sinf((dlat[i] - dlat[i - 1]) / 2), s2 = sinf((dlon[i] - dlon[i - 1]) / 2);
+            dist[i] = 2 * quad(r, (x1 + x2) / 2) * asinf(sqrtf(s1 * s1 + quad(c, x1) * quad(c, x2) * s2 * s2));
+        }
+    }
+}
+
+void flatf(const double lat0, const float *dlat, const float *dlon, const size_t n, float *dist)
+{
+    if (!n)
+        return;
+    dist[0] = 0;
+    for (size_t first = 1; first < n; first += BLOCKF) {
+        size_t last = n - first < BLOCKF ? n - 1 : first + BLOCKF - 1;
+        float mid;
+        double h;
+        blockspan(dlat, first - 1, last, &mid, &h);
+        if (h > SPANF) {
+            for (size_t i = first; i <= last; ++i) {
+                FlatScale sc;
+                setscale(&sc, lat0 + (dlat[i - 1] + dlat[i]) / 2);
+                float x = (float)sc.kx * (dlon[i] - dlon[i - 1]);
+                float y = (float)sc.ky * (dlat[i] - dlat[i - 1]);
+                dist[i] = sqrtf(x * x + y * y);
+            }
+            continue;
+        }
+        Quadratic kx = quadfit(flatkx, lat0 + mid, h);
+        Quadratic ky = quadfit(flatky, lat0 + mid, h);
+        for (size_t i = first; i <= last; ++i) {
+            float xm = (dlat[i - 1] + dlat[i]) / 2 - mid;
+            float x = quad(kx, xm) * (dlon[i] - dlon[i - 1]);
+            float y = quad(ky, xm) * (dlat[i] - dlat[i - 1]);
+            dist[i] = sqrtf(x * x + y * y);
+        }
+    }
+}
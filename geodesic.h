@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * GEODESIC DISTANCE KERNELS
+ * Surface distance between two lat/lon points on the WGS-84 ellipsoid, with a
+ * choice of methods from fast and approximate to slow and exact (error
+ * relative to the WGS-84 geodesic):
+ *
+ *     spherical  sphere with mean radius R1          max error 0.56%
+ *     haversine  sphere with local radius at avglat  max error 0.67%, ~0.2% typical
+ *     adaptive   flat earth if short enough, else    max error = tolerance in metres
+ *                vincenty                            (default 1 mm)
+ *     vincenty   ellipsoid, iterative                max error 0.5 mm
+ *     karney     ellipsoid, converges for all pairs  max error 1 um
+ *
+ * All coordinates are in radians, all distances in metres.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef GEODESIC_H_
+#define GEODESIC_H_
+
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include <math.h>     // M_PI
+
+// Mathematical constants
+#define DEG2RAD (M_PI / 180.0)  // pi/180 (degrees to radians)
+#define TOLERANCE 1e-3          // default max error in metres of the adaptive method
+
+// Line segment on the Earth surface defined by 2 lat/lon points
+// = four doubles addressable as either coor[0..3] or lat1,lon1,lat2,lon2
+typedef union {
+    double coor[4];
+    struct { double lat1, lon1, lat2, lon2; };
+} LineSegment;
+
+// Distance methods, from fastest and least accurate to slowest and most accurate
+typedef enum {
+    SPHERICAL,
+    HAVERSINE,
+    ADAPTIVE,
+    VINCENTY,
+    KARNEY,
+    METHODS  // number of methods
+} Method;
+
+// Method names as used on the command line
+extern const char *const methodname[METHODS];
+
+// Flat-earth scale around a reference latitude, reused for all nearby segments
+typedef struct {
+    double lat;       // reference latitude in radians, NAN = not set
+    double kx, ky;    // metres per radian of longitude and latitude at reference
+    double dkx, dky;  // derivatives of kx and ky w.r.t. latitude for first order correction
+    double t2;        // 1 + 2 tan^2(lat) for the error estimate
+} FlatScale;
+
+// Single segment kernels. The adaptive method needs a FlatScale that starts
+// with lat = NAN and is kept between calls for consecutive segments.
+double spherical(const LineSegment a);
+double haversine(const LineSegment a);
+double adaptive(const LineSegment a, FlatScale *sc, const double tol);
+double vincenty(const LineSegment a);
+double karney(const LineSegment a);
+
+// Same as vincenty() and karney(), also returning the number of iterations.
+// Vincenty iterations above 200 mean it fell back to Karney's method.
+double vincentyiter(const LineSegment a, int *iter);
+double karneyiter(const LineSegment a, int *iter);
+
+// Distances in metres of n line segments, all with the same method. Tolerance
+// in metres is only used by the adaptive method.
+void distances(const Method method, const LineSegment *seg, const size_t n, double *dist, const double tol);
+
+// Single precision for bulk visualisation. Coordinates are
+// float offsets in radians from an origin in double precision, which keeps
+// the error under a metre where absolute float coordinates would be off by
+// up to half a metre per point. relcoor() converts degrees to offsets, with
+// the first point as origin. Both kernels write dist[i] = distance from point
+// i-1 to point i (dist[0] = 0).
+void relcoor(const double *lat, const double *lon, const size_t n,
+    double *lat0, double *lon0, float *dlat, float *dlon);
+void haversinef(const double lat0, const float *dlat, const float *dlon, const size_t n, float *dist);
+void flatf(const double lat0, const float *dlat, const float *dlon, const size_t n, float *dist);
+
+#endif
@@ -0,0 +1,45 @@
+# Reference geodesics for benchdist, from GeographicLib (pip install geographiclib)
+# which is independent of the kernels in geodesic.c and accurate to 15 nm.
+# Writes geodesics.txt: one "dataset lat1 lon1 lat2 lon2 distance" per line,
+# coordinates in degrees, distance in metres on WGS-84.
+#
+# Author: E. Dronkert https://github.com/ednl
+# Licence: MIT (free to use as you like, with attribution)
+
+import random
+from geographiclib.geodesic import Geodesic
+
+CONTINENTS = 1000   # random pairs up to 60 degrees apart
+ANTIPODES = 500     # nearly antipodal pairs
+EQUATOR = 500       # pairs within 1e-10 to 1 degree of the equator
+ANTIMERIDIAN = 500  # pairs on either side of longitude 180
+
+def wrap(lon):
+    return lon - 360 if lon > 180 else (lon + 360 if lon < -180 else lon)
+
+def continental():
+    lat1, lon1 = random.uniform(-60, 60), random.uniform(-180, 180)
+    return lat1, lon1, random.uniform(-60, 60), wrap(lon1 + random.uniform(-60, 60))
+
+def antipodal():
+    lat1, lon1 = random.uniform(-80, 80), random.uniform(-180, 180)
+    d = 10 ** random.uniform(-8, -0.3)  # up to 0.5 degree off the antipode
+    return lat1, lon1, -lat1 + random.uniform(-d, d), wrap(lon1 + 180 + random.uniform(-d, d))
+
+def equatorial():
+    m = 10 ** random.uniform(-10, 0)
+    return random.uniform(-m, m), random.uniform(-180, 180), random.uniform(-m, m), random.uniform(-180, 180)
+
+def antimeridian():
+    return random.uniform(-80, 80), random.uniform(170, 180), random.uniform(-80, 80), random.uniform(-180, -170)
+
+random.seed(20231017)
+with open('geodesics.txt', 'w') as f:
+    f.write('# Reference geodesics on WGS-84 from GeographicLib, made by geodesics.py\n')
+    f.write('# dataset lat1 lon1 lat2 lon2 distance\n')
+    for name, count, pair in (('continental', CONTINENTS, continental), ('antipodal', ANTIPODES, antipodal),
+                              ('equatorial', EQUATOR, equatorial), ('antimeridian', ANTIMERIDIAN, antimeridian)):
+        for _ in range(count):
+            lat1, lon1, lat2, lon2 = pair()
+            s12 = Geodesic.WGS84.Inverse(lat1, lon1, lat2, lon2)['s12']
+            f.write(f'{name} {lat1!r} {lon1!r} {lat2!r} {lon2!r} {s12:.9f}\n')
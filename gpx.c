@@ -0,0 +1,577 @@
+/*****************************************************************************
+ * LIBGPX
+ * Public API on top of the internal modules, see gpx.h. Only functions
+ * marked GPX_API are exported from the shared library; everything else is
+ * compiled with hidden visibility.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // malloc, calloc, free
+#include <string.h>   // strcmp
+#include <math.h>     // NAN
+#include <stddef.h>   // offsetof
+#include "gpx.h"
+#include "gpxio.h"
+#include "trackbin.h"
+#include "polyline.h"
+#include "input.h"
+#include "parallel.h"
+#include "stats.h"
+#include "smooth.h"
+#include "dem.h"
+#include "timeedit.h"
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+#define SEGBLOCK 256  // segments per batch in gpx_distances()
+
+// Public enum values must stay equal to the internal ones
+_Static_assert((int)GPX_SPHERICAL == (int)SPHERICAL, "method");
+_Static_assert((int)GPX_HAVERSINE == (int)HAVERSINE, "method");
+_Static_assert((int)GPX_ADAPTIVE == (int)ADAPTIVE, "method");
+_Static_assert((int)GPX_VINCENTY == (int)VINCENTY, "method");
+_Static_assert((int)GPX_KARNEY == (int)KARNEY, "method");
+_Static_assert(GPX_NOTIME == NOTIME, "notime");
+_Static_assert(sizeof(gpx_segment_stats) == sizeof(SegStats), "stats");
+_Static_assert(offsetof(gpx_segment_stats, duration) == offsetof(SegStats, duration), "stats");
+_Static_assert((int)GPX_SMOOTH_KALMAN == (int)SMOOTH_KALMAN, "smoother");
+_Static_assert(sizeof(gpx_summary) == sizeof(Summary), "summary");
+_Static_assert(offsetof(gpx_summary, grade) == offsetof(Summary, grade), "summary");
+_Static_assert(GPX_GRADE_BINS == GRADEBINS && GPX_GRADE_MAX == GRADEMAX, "summary");
+_Static_assert(sizeof(gpx_summary_params) == sizeof(StatsParams), "summary");
+_Static_assert(sizeof(gpx_waypoint_match) == sizeof(WptMatch), "match");
+_Static_assert(offsetof(gpx_waypoint_match, offset) == offsetof(WptMatch, offset), "match");
+
+struct gpx_track {
+    Track trk;
+};
+
+struct gpx_arena {
+    Arena a;
+};
+
+struct gpx_waypoints {
+    Waypoints w;
+};
+
+struct gpx_dem {
+    Dem d;
+};
+
+struct gpx_parser {
+    GpxParser p;
+};
+
+static bool validmethod(const gpx_method method)
+{
+    return (int)method >= 0 && (int)method < METHODS;
+}
+
+int gpx_version(void)
+{
+    return GPX_VERSION;
+}
+
+const char *gpx_version_string(void)
+{
+    return STR(GPX_VERSION_MAJOR) "." STR(GPX_VERSION_MINOR) "." STR(GPX_VERSION_PATCH);
+}
+
+int gpx_method_from_name(const char *name)
+{
+    for (int i = 0; i < METHODS; ++i)
+        if (!strcmp(name, methodname[i]))
+            return i;
+    return -1;
+}
+
+const char *gpx_method_name(gpx_method method)
+{
+    return validmethod(method) ? methodname[method] : NULL;
+}
+
+double gpx_distance(gpx_method method, double tol,
+    double lat1, double lon1, double lat2, double lon2)
+{
+    if (!validmethod(method))
+        return NAN;
+    LineSegment a = {{lat1 * DEG2RAD, lon1 * DEG2RAD, lat2 * DEG2RAD, lon2 * DEG2RAD}};
+    double dist;
+    distances((Method)method, &a, 1, &dist, tol);
+    return dist;
+}
+
+gpx_status gpx_distances(gpx_method method, double tol,
+    const double *coor, size_t n, double *dist)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    LineSegment seg[SEGBLOCK];
+    for (size_t i = 0; i < n; i += SEGBLOCK) {
+        size_t m = n - i < SEGBLOCK ? n - i : SEGBLOCK;
+        for (size_t j = 0; j < m; ++j)
+            for (int k = 0; k < 4; ++k)
+                seg[j].coor[k] = coor[(i + j) * 4 + k] * DEG2RAD;
+        distances((Method)method, seg, m, dist + i, tol);
+    }
+    return GPX_OK;
+}
+
+gpx_status gpx_path_distances(gpx_method method, double tol,
+    const double *lat, const double *lon, size_t n, double *dist)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    pathdistances(lat, lon, n, (Method)method, tol, dist);
+    return GPX_OK;
+}
+
+void gpx_relative_coords(const double *lat, const double *lon, size_t n,
+    double *lat0, double *lon0, float *dlat, float *dlon)
+{
+    relcoor(lat, lon, n, lat0, lon0, dlat, dlon);
+}
+
+void gpx_path_haversinef(double lat0, const float *dlat, const float *dlon, size_t n, float *dist)
+{
+    haversinef(lat0, dlat, dlon, n, dist);
+}
+
+void gpx_path_flatf(double lat0, const float *dlat, const float *dlon, size_t n, float *dist)
+{
+    flatf(lat0, dlat, dlon, n, dist);
+}
+
+gpx_track *gpx_track_new(void)
+{
+    return calloc(1, sizeof(gpx_track));
+}
+
+void gpx_track_free(gpx_track *t)
+{
+    if (!t || t->trk.arena)
+        return;
+    trackfree(&t->trk);
+    free(t);
+}
+
+gpx_arena *gpx_arena_new(void)
+{
+    return calloc(1, sizeof(gpx_arena));
+}
+
+void gpx_arena_reset(gpx_arena *a)
+{
+    arenareset(&a->a);
+}
+
+void gpx_arena_free(gpx_arena *a)
+{
+    if (!a)
+        return;
+    arenafree(&a->a);
+    free(a);
+}
+
+gpx_track *gpx_track_new_in(gpx_arena *a)
+{
+    gpx_track *t = arenaalloc(&a->a, sizeof *t);
+    if (t)
+        *t = (gpx_track){{.arena = &a->a}};
+    return t;
+}
+
+void *gpx_arena_alloc(gpx_arena *a, size_t size)
+{
+    return arenaalloc(&a->a, size);
+}
+
+void gpx_track_clear(gpx_track *t)
+{
+    trackclear(&t->trk);
+}
+
+size_t gpx_track_size(const gpx_track *t)
+{
+    return t->trk.len;
+}
+
+gpx_status gpx_track_push(gpx_track *t, const gpx_point *pt)
+{
+    return trackpush(&t->trk, late7(pt->lat), toe7(pt->lon), pt->ele, pt->time) ? GPX_OK : GPX_ENOMEM;
+}
+
+size_t gpx_track_segment_count(const gpx_track *t)
+{
+    return segcount(&t->trk);
+}
+
+size_t gpx_track_track_count(const gpx_track *t)
+{
+    return trkcount(&t->trk);
+}
+
+gpx_status gpx_track_segment(const gpx_track *t, size_t i, size_t *first, size_t *last, size_t *trk)
+{
+    if (i >= segcount(&t->trk))
+        return GPX_EINVAL;
+    *first = segfirst(&t->trk, i);
+    *last = seglast(&t->trk, i);
+    *trk = segtrk(&t->trk, i);
+    return GPX_OK;
+}
+
+gpx_status gpx_track_new_segment(gpx_track *t, int newtrack)
+{
+    if (newtrack) {
+        if (!t->trk.ntrk && t->trk.len)
+            tracknewtrk(&t->trk);  // the points so far are the first track
+        tracknewtrk(&t->trk);
+    }
+    return tracknewseg(&t->trk) ? GPX_OK : GPX_ENOMEM;
+}
+
+gpx_status gpx_track_stats(const gpx_track *t, gpx_method method, double tol,
+    gpx_segment_stats *seg, gpx_segment_stats *trk)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    trackstats(&t->trk, (Method)method, tol, (SegStats *)seg, (SegStats *)trk);
+    return GPX_OK;
+}
+
+gpx_dem *gpx_dem_open(const char *dir)
+{
+    gpx_dem *d = malloc(sizeof *d);
+    if (d && !demopen(&d->d, dir)) {
+        free(d);
+        return NULL;
+    }
+    return d;
+}
+
+void gpx_dem_close(gpx_dem *d)
+{
+    if (!d)
+        return;
+    demclose(&d->d);
+    free(d);
+}
+
+double gpx_dem_elevation(gpx_dem *d, double lat, double lon)
+{
+    return demele(&d->d, late7(lat), toe7(lon));
+}
+
+size_t gpx_track_dem(gpx_dem *d, gpx_track *t)
+{
+    return demtrack(&d->d, &t->trk, 0, t->trk.len);
+}
+
+gpx_status gpx_track_smooth(gpx_track *t, gpx_smoother filter, double param)
+{
+    Smoother s;
+    if ((int)filter < 0 || (int)filter >= SMOOTHERS || !smoothinit(&s, (SmoothKind)filter, param))
+        return GPX_EINVAL;
+    tracksmooth(&t->trk, &s);
+    return GPX_OK;
+}
+
+void gpx_summary_init(gpx_summary *s)
+{
+    summaryinit((Summary *)s);
+}
+
+gpx_status gpx_track_summary(const gpx_track *t, gpx_method method, double tol,
+    const gpx_summary_params *params, gpx_summary *s)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    tracksummary(&t->trk, (Method)method, tol, (const StatsParams *)params, (Summary *)s);
+    return GPX_OK;
+}
+
+void gpx_summary_add(gpx_summary *a, const gpx_summary *b)
+{
+    summaryadd((Summary *)a, (const Summary *)b);
+}
+
+// Points [first, first + n) of a track store as public points
+static size_t copypoints(const Track *trk, size_t first, size_t n, gpx_point *out)
+{
+    if (first >= trk->len)
+        return 0;
+    if (n > trk->len - first)
+        n = trk->len - first;
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (gpx_point){e7deg(trk->lat[first + i]), e7deg(trk->lon[first + i]),
+            trk->ele[first + i], trk->time[first + i]};
+    return n;
+}
+
+size_t gpx_track_points(const gpx_track *t, size_t first, size_t n, gpx_point *out)
+{
+    return copypoints(&t->trk, first, n, out);
+}
+
+gpx_status gpx_track_distances(const gpx_track *t, gpx_method method, double tol, double *dist)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    trackdistances(&t->trk, (Method)method, tol, dist);
+    return GPX_OK;
+}
+
+gpx_status gpx_track_distances_mt(const gpx_track *t, gpx_method method, double tol, double *dist, int threads)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    trackdistancesmt(&t->trk, (Method)method, tol, dist, threads);
+    return GPX_OK;
+}
+
+void gpx_track_retime(gpx_track *t, const double *dist, int64_t start, double speed)
+{
+    trackretime(&t->trk, dist, start, speed);
+}
+
+gpx_status gpx_track_retime_mt(gpx_track *t, const double *dist, int64_t start, double speed, int threads)
+{
+    return trackretimemt(&t->trk, dist, start, speed, threads) ? GPX_OK : GPX_ENOMEM;
+}
+
+gpx_status gpx_track_edit_times(gpx_track *t, gpx_method method, double tol,
+    int64_t shift, double scale, int fill)
+{
+    if (!validmethod(method) || !(scale > 0))
+        return GPX_EINVAL;
+    TimeEdit e;
+    timeeditinit(&e, shift, scale, fill);
+    const bool ok = tracktimeedit(&t->trk, (Method)method, tol, &e);
+    timeeditfree(&e);
+    return ok ? GPX_OK : GPX_ENOMEM;
+}
+
+int64_t gpx_parse_time(const char *s, size_t len)
+{
+    int64_t ms;
+    return parseisotime(s, s + len, &ms) ? ms : GPX_NOTIME;
+}
+
+void gpx_cumulative(const double *x, size_t n, double *cum, int threads)
+{
+    prefixsum(x, n, cum, threads);
+}
+
+gpx_status gpx_cumulative_repro(const double *x, size_t n, double *cum, int threads)
+{
+    return reprosum(x, n, cum, threads) ? GPX_OK : GPX_ENOMEM;
+}
+
+gpx_status gpx_total_repro(const double *x, size_t n, int threads, double *total)
+{
+    return reprototal(x, n, threads, total) ? GPX_OK : GPX_ENOMEM;
+}
+
+gpx_status gpx_read_file(const char *fname, gpx_track *t)
+{
+    GpxParser p;
+    gpxinit(&p, &t->trk);
+    if (!gpxstream(&p, fname))
+        return GPX_EIO;
+    return p.oom ? GPX_ENOMEM : GPX_OK;
+}
+
+gpx_status gpx_read_file_all(const char *fname, gpx_track *t, gpx_waypoints *wpt, gpx_waypoints *rte)
+{
+    GpxParser p;
+    gpxinit(&p, t ? &t->trk : NULL);
+    p.wpt = wpt ? &wpt->w : NULL;
+    p.rte = rte ? &rte->w : NULL;
+    if (!gpxstream(&p, fname))
+        return GPX_EIO;
+    return p.oom ? GPX_ENOMEM : GPX_OK;
+}
+
+gpx_waypoints *gpx_waypoints_new(void)
+{
+    return calloc(1, sizeof(gpx_waypoints));
+}
+
+void gpx_waypoints_free(gpx_waypoints *w)
+{
+    if (!w)
+        return;
+    wptfree(&w->w);
+    free(w);
+}
+
+size_t gpx_waypoints_size(const gpx_waypoints *w)
+{
+    return w->w.pts.len;
+}
+
+size_t gpx_waypoints_points(const gpx_waypoints *w, size_t first, size_t n, gpx_point *out)
+{
+    return copypoints(&w->w.pts, first, n, out);
+}
+
+const char *gpx_waypoints_name(const gpx_waypoints *w, size_t i)
+{
+    return i < w->w.pts.len ? wptname(&w->w, i) : NULL;
+}
+
+size_t gpx_waypoints_route_count(const gpx_waypoints *w)
+{
+    return segcount(&w->w.pts);
+}
+
+gpx_status gpx_waypoints_route(const gpx_waypoints *w, size_t i, size_t *first, size_t *last)
+{
+    if (i >= segcount(&w->w.pts))
+        return GPX_EINVAL;
+    *first = segfirst(&w->w.pts, i);
+    *last = seglast(&w->w.pts, i);
+    return GPX_OK;
+}
+
+gpx_status gpx_waypoints_along(const gpx_track *t, const gpx_waypoints *w,
+    gpx_method method, double tol, gpx_waypoint_match *m)
+{
+    if (!validmethod(method))
+        return GPX_EINVAL;
+    return wptalong(&t->trk, &w->w, (Method)method, tol, (WptMatch *)m) ? GPX_OK : GPX_ENOMEM;
+}
+
+gpx_status gpx_read_buffer(const char *buf, size_t len, gpx_track *t)
+{
+    GpxParser p;
+    gpxinit(&p, &t->trk);
+    gpxparse(&p, buf, len, true);
+    return p.oom ? GPX_ENOMEM : GPX_OK;
+}
+
+gpx_status gpx_read_file_mt(const char *fname, int threads, gpx_track *t)
+{
+    Input in;
+    if (!loadinput(&in, fname))
+        return GPX_EIO;
+    gpx_status status = gpxparsemt(in.buf, in.size, threads, &t->trk) ? GPX_OK : GPX_ENOMEM;
+    freeinput(&in);
+    return status;
+}
+
+gpx_parser *gpx_parser_new(gpx_track *t)
+{
+    gpx_parser *p = malloc(sizeof *p);
+    if (p)
+        gpxinit(&p->p, t ? &t->trk : NULL);
+    return p;
+}
+
+size_t gpx_parser_feed(gpx_parser *p, const char *buf, size_t len, int last)
+{
+    return gpxparse(&p->p, buf, len, last != 0);
+}
+
+gpx_status gpx_parser_status(const gpx_parser *p)
+{
+    return p->p.oom ? GPX_ENOMEM : GPX_OK;
+}
+
+void gpx_parser_free(gpx_parser *p)
+{
+    free(p);
+}
+
+gpx_status gpx_write_file(const char *fname, const gpx_track *t)
+{
+    return gpxwrite(fname, &t->trk) ? GPX_OK : GPX_EIO;
+}
+
+gpx_status gpx_format(const gpx_track *t, char **buf, size_t *len)
+{
+    TextBuffer out = {0};
+    if (!gpxformat(&t->trk, &out)) {
+        free(out.buf);
+        return GPX_ENOMEM;
+    }
+    *buf = out.buf;
+    *len = out.len;
+    return GPX_OK;
+}
+
+gpx_status gpx_pack(const gpx_track *t, char **buf, size_t *len)
+{
+    TextBuffer out = {0};
+    if (!trackpack(&t->trk, &out)) {
+        free(out.buf);
+        return GPX_ENOMEM;
+    }
+    *buf = out.buf;
+    *len = out.len;
+    return GPX_OK;
+}
+
+gpx_status gpx_unpack(const char *buf, size_t len, gpx_track *t)
+{
+    switch (trackunpack(buf, len, &t->trk)) {
+        case UNPACK_OK: return GPX_OK;
+        case UNPACK_NOMEM: return GPX_ENOMEM;
+        default: return GPX_EFORMAT;
+    }
+}
+
+gpx_status gpx_write_packed(const char *fname, const gpx_track *t)
+{
+    TextBuffer out = {0};
+    if (!trackpack(&t->trk, &out)) {
+        free(out.buf);
+        return GPX_ENOMEM;
+    }
+    gpx_status status = writefile(fname, out.buf, out.len) ? GPX_OK : GPX_EIO;
+    free(out.buf);
+    return status;
+}
+
+gpx_status gpx_read_packed(const char *fname, gpx_track *t)
+{
+    Input in;
+    if (!loadinput(&in, fname))
+        return GPX_EIO;
+    gpx_status status = gpx_unpack(in.buf, in.size, t);
+    freeinput(&in);
+    return status;
+}
+
+size_t gpx_polyline_encode(const gpx_track *t, int precision, char *out)
+{
+    PolyState st;
+    if (!polyinit(&st, precision))
+        return 0;
+    size_t len = polyencode(&st, t->trk.lat, t->trk.lon, t->trk.len, out);
+    out[len] = '\0';
+    return len;
+}
+
+gpx_status gpx_polyline_decode(const char *s, size_t len, int precision, gpx_track *t)
+{
+    PolyState st;
+    if (!polyinit(&st, precision))
+        return GPX_EINVAL;
+    // At least 2 characters per point, so one reservation is enough
+    Track *trk = &t->trk;
+    if (!trackreserve(trk, trk->len + len / 2))
+        return GPX_ENOMEM;
+    const char *end = s + len;
+    size_t first = trk->len;
+    size_t n = polydecode(&st, &s, end, trk->lat + first, trk->lon + first, len / 2);
+    for (size_t i = first; i < first + n; ++i) {
+        trk->ele[i] = NAN;
+        trk->time[i] = NOTIME;
+    }
+    trk->len += n;
+    return s == end ? GPX_OK : GPX_EFORMAT;
+}
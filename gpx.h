@@ -0,0 +1,343 @@
+/*****************************************************************************
+ * LIBGPX
+ * Public API of the GPX library: geodesic distance kernels, track store,
+ * GPX reader and writer. Link with -lgpx -lz -lm -lpthread.
+ *
+ * ABI stability: within one major version, functions and enum values are
+ * only ever added, never changed or removed. Tracks and parsers are opaque
+ * handles, so their layout can change without breaking programs compiled
+ * against an older header. The public structs gpx_point, gpx_segment_stats,
+ * gpx_waypoint_match, gpx_summary_params and gpx_summary have a frozen
+ * layout within a major version; gpx.c checks them against the internal ones.
+ *
+ * Units: coordinates in decimal degrees, distances in metres, elevation in
+ * metres (NAN if missing), time in milliseconds since 1970-01-01T00:00:00Z
+ * (GPX_NOTIME if missing).
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef GPX_H_
+#define GPX_H_
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // int64_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPX_VERSION_MAJOR 1
+#define GPX_VERSION_MINOR 15
+#define GPX_VERSION_PATCH 0
+#define GPX_VERSION (GPX_VERSION_MAJOR * 10000 + GPX_VERSION_MINOR * 100 + GPX_VERSION_PATCH)
+
+#if defined(_WIN32)
+#define GPX_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define GPX_API __attribute__((visibility("default")))
+#else
+#define GPX_API
+#endif
+
+#define GPX_NOTIME INT64_MIN     // time of a point without timestamp
+#define GPX_TOLERANCE 1e-3       // default max error in metres of GPX_ADAPTIVE
+#define GPX_POLYLINE_MAXLEN 14   // max characters per point of an encoded polyline
+
+// Status codes
+typedef enum {
+    GPX_OK     =  0,
+    GPX_ENOMEM = -1,  // out of memory
+    GPX_EIO    = -2,  // file could not be read or written
+    GPX_EINVAL = -3,  // invalid argument
+    GPX_EFORMAT = -4, // not a packed track or corrupt data
+} gpx_status;
+
+// Distance methods, from fastest and least accurate to slowest and most
+// accurate; max error relative to the WGS-84 geodesic:
+//   GPX_SPHERICAL  0.56%
+//   GPX_HAVERSINE  0.67%, ~0.2% typical
+//   GPX_ADAPTIVE   tolerance in metres
+//   GPX_VINCENTY   0.5 mm
+//   GPX_KARNEY     1 um
+typedef enum {
+    GPX_SPHERICAL = 0,
+    GPX_HAVERSINE = 1,
+    GPX_ADAPTIVE  = 2,
+    GPX_VINCENTY  = 3,
+    GPX_KARNEY    = 4,
+} gpx_method;
+
+typedef struct {
+    double lat, lon, ele;
+    int64_t time;
+} gpx_point;
+
+// Statistics of one segment (trkseg) or track (trk)
+typedef struct {
+    size_t points;
+    double length;           // metres, point to point within segments
+    double ascent, descent;  // metres, between consecutive points with elevation
+    int64_t start, end;      // first and last time, GPX_NOTIME if none
+    int64_t duration;        // ms, end - start; for a track the sum over its segments
+} gpx_segment_stats;
+
+// Waypoint on a track
+typedef struct {
+    size_t index;   // nearest track point, SIZE_MAX if the track or waypoint has no position
+    double along;   // metres along the track, without gaps, to the nearest position on it
+    double offset;  // metres from the waypoint to that position
+} gpx_waypoint_match;
+
+// Summary of whole tracks or files, see gpx_track_summary()
+#define GPX_GRADE_MAX  20  // percent
+#define GPX_GRADE_BINS 41  // bin i: grade rounded to whole percent is i - GPX_GRADE_MAX
+
+typedef struct {
+    double hysteresis;  // metres, climbs and descents smaller than this are noise (default 5)
+    double gradedist;   // metres, minimum distance of one grade (default 100)
+} gpx_summary_params;
+
+typedef struct {
+    size_t files, points, segments;
+    double length;                // metres, within segments
+    double ascent, descent;       // metres, with hysteresis
+    double rawascent, rawdescent; // metres, point to point
+    double minele, maxele;        // metres, NAN if no elevation
+    double mingrade, maxgrade;    // percent, NAN if no grade
+    int64_t duration;             // ms, sum over segments
+    double grade[GPX_GRADE_BINS]; // metres of track per grade, outer bins include everything steeper
+} gpx_summary;
+
+// Elevation filters, see gpx_track_smooth()
+typedef enum {
+    GPX_SMOOTH_NONE   = 0,
+    GPX_SMOOTH_SG     = 1,
+    GPX_SMOOTH_MEDIAN = 2,
+    GPX_SMOOTH_KALMAN = 3,
+} gpx_smoother;
+
+typedef struct gpx_track gpx_track;
+typedef struct gpx_parser gpx_parser;
+typedef struct gpx_arena gpx_arena;
+typedef struct gpx_waypoints gpx_waypoints;
+typedef struct gpx_dem gpx_dem;
+
+// Library version at run time, compare with GPX_VERSION
+GPX_API int gpx_version(void);
+GPX_API const char *gpx_version_string(void);
+
+// Method by name ("spherical", "haversine", "adaptive", "vincenty", "karney"),
+// or -1 if unknown; name of a method or NULL if invalid
+GPX_API int gpx_method_from_name(const char *name);
+GPX_API const char *gpx_method_name(gpx_method method);
+
+// Distance between two points, NAN for an invalid method
+GPX_API double gpx_distance(gpx_method method, double tol,
+    double lat1, double lon1, double lat2, double lon2);
+
+// Distances of n segments given as lat1,lon1,lat2,lon2 per segment in coor[0..4n)
+GPX_API gpx_status gpx_distances(gpx_method method, double tol,
+    const double *coor, size_t n, double *dist);
+
+// Distances from point i-1 to point i along a path of n points (dist[0] = 0)
+GPX_API gpx_status gpx_path_distances(gpx_method method, double tol,
+    const double *lat, const double *lon, size_t n, double *dist);
+
+// Single precision path distances for bulk visualisation (dist[0] = 0). Input
+// is relative: lat0 in radians and float offsets in radians, as made from
+// degrees by gpx_relative_coords() with the first point as origin. Error is
+// under 1 m per segment for the haversine, a few mm for the flat earth
+// version up to ~10 km segments.
+GPX_API void gpx_relative_coords(const double *lat, const double *lon, size_t n,
+    double *lat0, double *lon0, float *dlat, float *dlon);
+GPX_API void gpx_path_haversinef(double lat0, const float *dlat, const float *dlon, size_t n, float *dist);
+GPX_API void gpx_path_flatf(double lat0, const float *dlat, const float *dlon, size_t n, float *dist);
+
+// Track store. Coordinates are kept as 1e-7 degree fixed point (~1 cm), so
+// GPX coordinates with up to 7 decimals read and write back unchanged. A
+// latitude beyond +/-90 or longitude beyond +/-180 is stored as missing.
+GPX_API gpx_track *gpx_track_new(void);
+GPX_API void gpx_track_free(gpx_track *t);
+GPX_API void gpx_track_clear(gpx_track *t);
+GPX_API size_t gpx_track_size(const gpx_track *t);
+GPX_API gpx_status gpx_track_push(gpx_track *t, const gpx_point *pt);
+
+// Arena for batch processing of many files: tracks made with
+// gpx_track_new_in() live in the arena with all their points and are gone
+// after gpx_arena_reset() (gpx_track_free() ignores them), which keeps the
+// memory for the next file. One arena per thread; memory mapped GPX files
+// then need no malloc per file once the arena has grown to the size of the
+// largest file.
+GPX_API gpx_arena *gpx_arena_new(void);
+GPX_API void gpx_arena_reset(gpx_arena *a);
+GPX_API void gpx_arena_free(gpx_arena *a);
+GPX_API gpx_track *gpx_track_new_in(gpx_arena *a);
+
+// Memory from the arena, e.g. for the distances of a track in it; NULL if out of memory
+GPX_API void *gpx_arena_alloc(gpx_arena *a, size_t size);
+
+// Segments and tracks: the trkseg and trk elements of the GPX files read, or
+// made with gpx_track_new_segment() before pushing points. A track without
+// any is one segment in one track.
+GPX_API size_t gpx_track_segment_count(const gpx_track *t);
+GPX_API size_t gpx_track_track_count(const gpx_track *t);
+
+// Points [first, last) and track index of segment i, GPX_EINVAL if i is out of range
+GPX_API gpx_status gpx_track_segment(const gpx_track *t, size_t i, size_t *first, size_t *last, size_t *trk);
+
+// The next pushed point starts a new segment, in a new track if newtrack is non-zero
+GPX_API gpx_status gpx_track_new_segment(gpx_track *t, int newtrack);
+
+// Statistics of every segment and every track in one pass, without joining
+// segments across gaps; seg and trk have room for gpx_track_segment_count()
+// and gpx_track_track_count() elements
+GPX_API gpx_status gpx_track_stats(const gpx_track *t, gpx_method method, double tol,
+    gpx_segment_stats *seg, gpx_segment_stats *trk);
+
+// Smooth the elevations of every segment in place with fixed memory, points
+// without elevation are skipped:
+//   GPX_SMOOTH_SG      Savitzky-Golay (quadratic) over 2 * param + 1 points, param 1..32 (default 5)
+//   GPX_SMOOTH_MEDIAN  median of 2 * param + 1 points, param 1..32 (default 2)
+//   GPX_SMOOTH_KALMAN  1D Kalman, param = measurement noise in metres (default 3)
+// param 0 = default; GPX_EINVAL if filter or param is out of range
+GPX_API gpx_status gpx_track_smooth(gpx_track *t, gpx_smoother filter, double param);
+
+// Elevation model from SRTM style .hgt tiles in directory dir (N50E003.hgt,
+// S23W044.hgt: big-endian 16-bit metres, 1201 or 3601 samples square),
+// memory mapped when first needed and cached; NULL if out of memory. Not
+// thread-safe: use one per thread.
+GPX_API gpx_dem *gpx_dem_open(const char *dir);
+GPX_API void gpx_dem_close(gpx_dem *d);
+
+// Bilinear elevation at a point in degrees, NAN if there is no tile or no data
+GPX_API double gpx_dem_elevation(gpx_dem *d, double lat, double lon);
+
+// Replace the elevation of every point by that of the model where it has
+// data; returns the number of points replaced
+GPX_API size_t gpx_track_dem(gpx_dem *d, gpx_track *t);
+
+// Empty summary
+GPX_API void gpx_summary_init(gpx_summary *s);
+
+// Add the length, climbing and grades of the whole track to s in one pass;
+// params = NULL for the defaults. Elevation changes count once they reach
+// the hysteresis. Grades are from elevations at least gradedist apart;
+// shorter rests at the end of a segment only count in the histogram.
+GPX_API gpx_status gpx_track_summary(const gpx_track *t, gpx_method method, double tol,
+    const gpx_summary_params *params, gpx_summary *s);
+
+// Add summary b to a, e.g. to aggregate several files (set files yourself)
+GPX_API void gpx_summary_add(gpx_summary *a, const gpx_summary *b);
+
+// Copy n points starting at index first, returns the number of points copied
+GPX_API size_t gpx_track_points(const gpx_track *t, size_t first, size_t n, gpx_point *out);
+
+// Distance from point i-1 to point i for every point (dist[0] = 0), dist has gpx_track_size() elements
+GPX_API gpx_status gpx_track_distances(const gpx_track *t, gpx_method method, double tol, double *dist);
+
+// The same on up to threads threads, 0 = all processors
+GPX_API gpx_status gpx_track_distances_mt(const gpx_track *t, gpx_method method, double tol, double *dist, int threads);
+
+// New timestamps at constant speed in m/s from start time, with distances from gpx_track_distances()
+GPX_API void gpx_track_retime(gpx_track *t, const double *dist, int64_t start, double speed);
+GPX_API gpx_status gpx_track_retime_mt(gpx_track *t, const double *dist, int64_t start, double speed, int threads);
+
+// Edit the existing times in one pass: add shift ms, multiply the durations
+// since the first time by scale (1 = keep), and if fill is non-zero give
+// points without time within a segment one in proportion to the distance
+// between the timed points around them. GPX_EINVAL if scale is not positive.
+GPX_API gpx_status gpx_track_edit_times(gpx_track *t, gpx_method method, double tol,
+    int64_t shift, double scale, int fill);
+
+// ISO-8601 time ("2023-03-24T10:00:00Z", fraction and offset optional) to
+// ms since 1970-01-01T00:00:00Z, GPX_NOTIME if invalid
+GPX_API int64_t gpx_parse_time(const char *s, size_t len);
+
+// Cumulative sum cum[i] = x[0] + ... + x[i] of n values (cum may be x), with
+// compensated summation, on up to threads threads (0 = all processors)
+GPX_API void gpx_cumulative(const double *x, size_t n, double *cum, int threads);
+
+// Reproducible cumulative sum and total (equal to the last cumulative value):
+// bit-identical for any number of threads and on any machine with IEEE 754
+// doubles, for official distances. Slower than gpx_cumulative().
+GPX_API gpx_status gpx_cumulative_repro(const double *x, size_t n, double *cum, int threads);
+GPX_API gpx_status gpx_total_repro(const double *x, size_t n, int threads, double *total);
+
+// Append all track points of a GPX file or buffer to the track. Files are
+// memory mapped; "-" and other unmappable files (pipes) are read in chunks.
+// Gzip files (and zstd if built with ZSTD=1) are recognised by their magic
+// number and decompressed on a separate thread while parsing.
+GPX_API gpx_status gpx_read_file(const char *fname, gpx_track *t);
+GPX_API gpx_status gpx_read_buffer(const char *buf, size_t len, gpx_track *t);
+
+// Parse one large file on up to threads threads (0 = all processors) by
+// splitting it into byte ranges that each start at a trkpt element
+GPX_API gpx_status gpx_read_file_mt(const char *fname, int threads, gpx_track *t);
+
+// Track points, waypoints (wpt) and route points (rtept) of a GPX file in
+// one pass; any of t, wpt and rte may be NULL to skip those points
+GPX_API gpx_status gpx_read_file_all(const char *fname, gpx_track *t, gpx_waypoints *wpt, gpx_waypoints *rte);
+
+// Waypoints or route points with their names. For route points every rte
+// element is a route, numbered like the segments of a track.
+GPX_API gpx_waypoints *gpx_waypoints_new(void);
+GPX_API void gpx_waypoints_free(gpx_waypoints *w);
+GPX_API size_t gpx_waypoints_size(const gpx_waypoints *w);
+GPX_API size_t gpx_waypoints_points(const gpx_waypoints *w, size_t first, size_t n, gpx_point *out);
+
+// Name of point i, "" if it has none, NULL if i is out of range
+GPX_API const char *gpx_waypoints_name(const gpx_waypoints *w, size_t i);
+
+// Routes: points [first, last) of route i, GPX_EINVAL if i is out of range
+GPX_API size_t gpx_waypoints_route_count(const gpx_waypoints *w);
+GPX_API gpx_status gpx_waypoints_route(const gpx_waypoints *w, size_t i, size_t *first, size_t *last);
+
+// Distance along the track to every waypoint (m has gpx_waypoints_size()
+// elements): the nearest track position, on the segments next to the
+// nearest track point. On a track that passes a waypoint more than once,
+// the nearest pass wins.
+GPX_API gpx_status gpx_waypoints_along(const gpx_track *t, const gpx_waypoints *w,
+    gpx_method method, double tol, gpx_waypoint_match *m);
+
+// Incremental reader: feed consecutive buffers, the return value is the number
+// of bytes consumed; pass the rest again at the start of the next buffer. Set
+// last to non-zero for the final buffer.
+GPX_API gpx_parser *gpx_parser_new(gpx_track *t);
+GPX_API size_t gpx_parser_feed(gpx_parser *p, const char *buf, size_t len, int last);
+GPX_API gpx_status gpx_parser_status(const gpx_parser *p);
+GPX_API void gpx_parser_free(gpx_parser *p);
+
+// Write the track as a GPX file, or as GPX text in a new buffer (release with free()).
+// Points without lat or lon are left out, GPX requires both.
+GPX_API gpx_status gpx_write_file(const char *fname, const gpx_track *t);
+GPX_API gpx_status gpx_format(const gpx_track *t, char **buf, size_t *len);
+
+// Packed binary track: delta encoded varints, lossless for coordinates with
+// up to 7 decimals, elevation with up to 3 and times in ms, about 6x smaller
+// than GPX and much faster to read. gpx_pack() returns a new buffer (release
+// with free()); gpx_unpack() and gpx_read_packed() append to the track.
+// Segment boundaries are not stored.
+GPX_API gpx_status gpx_pack(const gpx_track *t, char **buf, size_t *len);
+GPX_API gpx_status gpx_unpack(const char *buf, size_t len, gpx_track *t);
+GPX_API gpx_status gpx_write_packed(const char *fname, const gpx_track *t);
+GPX_API gpx_status gpx_read_packed(const char *fname, gpx_track *t);
+
+// Encoded polyline (Google format) with 1 to 7 decimals: 5 is Google's,
+// 6 is used by OSRM. out must have room for gpx_track_size() *
+// GPX_POLYLINE_MAXLEN + 1 characters; returns the length of the
+// NUL-terminated polyline, 0 if precision is out of range. All points must
+// have coordinates.
+GPX_API size_t gpx_polyline_encode(const gpx_track *t, int precision, char *out);
+
+// Append the points of an encoded polyline to the track, without elevation
+// or time; GPX_EFORMAT if the polyline is invalid (valid points before the
+// error are kept)
+GPX_API gpx_status gpx_polyline_decode(const char *s, size_t len, int precision, gpx_track *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
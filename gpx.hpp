@@ -0,0 +1,514 @@
+/*****************************************************************************
+ * LIBGPX C++ FRONT-END
+ * Header-only templates of the distance kernels in geodesic.c, parameterized
+ * on method, floating point type and ellipsoid so that all ellipsoid
+ * constants are compile-time and the kernels inline into the caller's loop.
+ * Needs C++17, does not need libgpx itself.
+ *
+ *     double d = gpx::distance<gpx::Method::Vincenty>(lat1, lon1, lat2, lon2);
+ *     gpx::path<gpx::Method::Adaptive, float>(lat, lon, n, dist);
+ *
+ * Coordinates are in radians, distances in metres. Error bounds of the
+ * methods are as in gpx.h for double. With float, the spherical, haversine
+ * and adaptive kernels lose precision on short segments when given absolute
+ * coordinates (float has ~0.5 m resolution at earth radius). Vincenty and
+ * Karney with float converge to float precision only.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef GPX_HPP_
+#define GPX_HPP_
+
+#include <array>        // array
+#include <cmath>        // sin, cos, asin, atan, atan2, sqrt, hypot, fabs
+#include <cstddef>      // size_t
+#include <limits>       // numeric_limits
+#include <type_traits>  // is_floating_point, is_same
+
+namespace gpx {
+
+// Reference ellipsoids: equatorial radius a in metres and inverse flattening
+struct WGS84 { static constexpr double a = 6378137.0, finv = 298.257223563; };
+struct GRS80 { static constexpr double a = 6378137.0, finv = 298.257222101; };
+
+// Same order and meaning as gpx_method in gpx.h
+enum class Method { Spherical, Haversine, Adaptive, Vincenty, Karney };
+
+// Ellipsoid constants in type T, all compile-time
+template <typename E, typename T>
+struct Constants {
+    static_assert(std::is_floating_point<T>::value, "T must be float, double or long double");
+    static constexpr T pi  = T(3.14159265358979323846264338327950288L);
+    static constexpr T a   = T(E::a);                       // equatorial radius
+    static constexpr T f   = T(1 / E::finv);                // flattening
+    static constexpr T f1  = T(1 - 1 / E::finv);            // 1-f
+    static constexpr T f16 = T(1 / E::finv / 16);           // f/16
+    static constexpr T b   = T(E::a * (1 - 1 / E::finv));   // polar radius
+    static constexpr T r1  = T((2 * E::a + E::a * (1 - 1 / E::finv)) / 3);  // mean radius
+    static constexpr T a2  = a * a;
+    static constexpr T b2  = b * b;
+    static constexpr T rf  = (a2 - b2) / b2;                // second eccentricity squared
+    static constexpr T e2  = (a2 - b2) / a2;                // first eccentricity squared
+    static constexpr T n   = f / (2 - f);                   // third flattening
+    // Convergence: 1e-12 as in geodesic.c for double, scaled for float
+    static constexpr T eps = std::is_same<T, float>::value ? T(1e-6) : T(1e-12);
+    static constexpr T tol0 = std::numeric_limits<T>::epsilon();
+    static constexpr int maxiter = 200;
+    static constexpr int newton = 20;    // Karney Newton steps before only bisecting
+    static constexpr int vinciter = 50;  // Vincenty iterations before handing over to Karney
+    static constexpr T latspan = T(1e-3);
+};
+
+namespace detail {
+
+template <typename T>
+inline bool equal(const T a, const T b, const T eps)
+{
+    return std::fabs(a - b) <= eps;
+}
+
+template <typename T>
+inline T centralangle(const T lat1, const T lon1, const T lat2, const T lon2)
+{
+    const T slat = std::sin((lat2 - lat1) / 2);
+    const T slon = std::sin((lon2 - lon1) / 2);
+    return 2 * std::asin(std::sqrt(slat * slat + std::cos(lat1) * std::cos(lat2) * slon * slon));
+}
+
+// Geocentric radius at latitude
+template <typename E, typename T>
+inline T localradius(const T lat)
+{
+    using C = Constants<E, T>;
+    const T s = std::sin(lat), c = std::cos(lat);
+    const T rs = C::b2 * s * s, rc = C::a2 * c * c;
+    return std::sqrt((C::b2 * rs + C::a2 * rc) / (rs + rc));
+}
+
+// Sine, cosine and square root for the radius table at compile time, where
+// <cmath> is not constexpr: Taylor series and Newton's method in long double,
+// rounded to the nearest T the same as the library functions for 0 <= x <= pi/2
+template <typename T>
+constexpr T ctsin(const T x)
+{
+    const long double x2 = static_cast<long double>(x) * x;
+    long double term = x, sum = 0;
+    for (int k = 1; k < 60; k += 2) {
+        sum += term;
+        term *= -x2 / ((k + 1) * (k + 2));
+    }
+    return static_cast<T>(sum);
+}
+
+template <typename T>
+constexpr T ctcos(const T x)
+{
+    const long double x2 = static_cast<long double>(x) * x;
+    long double term = 1, sum = 0;
+    for (int k = 0; k < 60; k += 2) {
+        sum += term;
+        term *= -x2 / ((k + 1) * (k + 2));
+    }
+    return static_cast<T>(sum);
+}
+
+template <typename T>
+constexpr T ctsqrt(const T x)
+{
+    long double r = x > 1 ? static_cast<long double>(x) : 1, prev = 0;
+    while (r != prev) {
+        prev = r;
+        r = (r + x / r) / 2;
+    }
+    return static_cast<T>(r);
+}
+
+// Geocentric radius by linear interpolation in a table of 0.5 degree steps,
+// the same as tableradius() in geodesic.c so that haversine gives the same
+// results as the library; made at compile time, so no guard on every call
+constexpr int radsteps = 180;
+
+template <typename E, typename T>
+constexpr std::array<T, radsteps + 1> makeradius()
+{
+    using C = Constants<E, T>;
+    std::array<T, radsteps + 1> r{};
+    for (int i = 0; i <= radsteps; ++i) {
+        const T lat = static_cast<T>(i) * (C::pi / 2 / radsteps);
+        const T s = ctsin(lat), c = ctcos(lat);
+        const T rs = C::b2 * s * s, rc = C::a2 * c * c;
+        r[i] = ctsqrt((C::b2 * rs + C::a2 * rc) / (rs + rc));
+    }
+    return r;
+}
+
+template <typename E, typename T>
+inline constexpr std::array<T, radsteps + 1> radius = makeradius<E, T>();
+
+template <typename E, typename T>
+inline T tableradius(const T lat)
+{
+    constexpr const std::array<T, radsteps + 1> &r = radius<E, T>;
+    const T x = std::fabs(lat) * (radsteps / (Constants<E, T>::pi / 2));
+    const int i = static_cast<int>(x);
+    if (i >= radsteps)
+        return r[radsteps];
+    return r[i] + (x - static_cast<T>(i)) * (r[i + 1] - r[i]);
+}
+
+// Gauss-Legendre quadrature, 16 points: positive half of the symmetric nodes and weights
+template <typename T>
+struct Gauss {
+    static constexpr T node[8] = {
+        T(0.095012509837637441), T(0.28160355077925892), T(0.45801677765722737), T(0.61787624440264377),
+        T(0.755404408355003),    T(0.86563120238783176), T(0.9445750230732326),  T(0.98940093499164994)};
+    static constexpr T weight[8] = {
+        T(0.18945061045506847), T(0.18260341504492361), T(0.16915651939500256), T(0.14959598881657682),
+        T(0.12462897125553395), T(0.095158511682492897), T(0.062253523938647776), T(0.027152459411754058)};
+};
+
+// Integrals i1, i3 and j on the auxiliary sphere, see integrals() in geodesic.c
+template <typename E, typename T>
+inline void integrals(const T sigma1, const T sigma2, const T k2, T &i1, T &i3, T &j)
+{
+    using C = Constants<E, T>;
+    int panels = static_cast<int>(std::ceil((sigma2 - sigma1) / (C::pi / 2)));
+    if (panels < 1)
+        panels = 1;
+    const T h = (sigma2 - sigma1) / (2 * panels);
+    T sum1 = 0, sum3 = 0, sumj = 0;
+    for (int i = 0; i < panels; ++i) {
+        const T mid = sigma1 + (2 * i + 1) * h;
+        for (int k = 0; k < 8; ++k)
+            for (int sign = -1; sign <= 1; sign += 2) {
+                const T s = std::sin(mid + sign * h * Gauss<T>::node[k]);
+                const T t = std::sqrt(1 + k2 * s * s);
+                sum1 += Gauss<T>::weight[k] * t;
+                sum3 += Gauss<T>::weight[k] * (2 - C::f) / (1 + C::f1 * t);
+                sumj += Gauss<T>::weight[k] * (t - 1 / t);
+            }
+    }
+    i1 = sum1 * h;
+    i3 = sum3 * h;
+    j = sumj * h;
+}
+
+// Geodesic from point 1 with azimuth alpha1, see Geodesic in geodesic.c
+template <typename T>
+struct Geodesic {
+    T eta, dv, sig12, m12, dist;
+};
+
+// Geodesic for azimuth alpha1 compared to lambda12, see geodesic() in geodesic.c
+template <typename E, typename T>
+inline Geodesic<T> geodesic(const T sb1, const T cb1, const T sb2, const T cb2,
+    const T sa1, const T ca1, const T slam, const T clam)
+{
+    using C = Constants<E, T>;
+    const T sa0 = sa1 * cb1;
+    const T ca0 = std::hypot(ca1, sa1 * sb1);
+    const T ca2cb2 = cb2 != cb1 || std::fabs(sb2) != -sb1
+        ? std::sqrt(ca1 * ca1 * cb1 * cb1 + (cb1 < -sb1 ? (cb2 - cb1) * (cb1 + cb2) : (sb1 - sb2) * (sb1 + sb2)))
+        : std::fabs(ca1) * cb1;
+    const T n1 = std::hypot(sb1, ca1 * cb1), n2 = std::hypot(sb2, ca2cb2);
+    const T ss1 = sb1 / n1, cs1 = ca1 * cb1 / n1;
+    const T ss2 = sb2 / n2, cs2 = ca2cb2 / n2;
+    const T sigma1 = std::atan2(ss1, cs1);
+    const T sig12 = std::atan2(std::fmax(T(0), cs1 * ss2 - ss1 * cs2), cs1 * cs2 + ss1 * ss2);
+    const T so1 = sa0 * sb1, co1 = ca1 * cb1, so2 = sa0 * sb2, co2 = ca2cb2;
+    const T somg = std::fmax(T(0), co1 * so2 - so1 * co2), comg = co1 * co2 + so1 * so2;
+    const T eta = std::atan2(somg * clam - comg * slam, comg * clam + somg * slam);
+    const T k2 = C::rf * ca0 * ca0;
+    T i1, i3, j;
+    integrals<E, T>(sigma1, sigma1 + sig12, k2, i1, i3, j);
+    const T w1 = std::sqrt(1 + k2 * ss1 * ss1), w2 = std::sqrt(1 + k2 * ss2 * ss2);
+    const T m12b = w2 * cs1 * ss2 - w1 * ss1 * cs2 - cs1 * cs2 * j;
+    return {eta - C::f * sa0 * i3,
+            ca2cb2 != 0 ? C::f1 * m12b / ca2cb2 : -2 * C::f1 * std::sqrt(1 + C::rf * sb1 * sb1) / sb1,
+            sig12, C::b * m12b, C::b * i1};
+}
+
+// Positive root of Karney's astroid equation, see astroid() in geodesic.c
+template <typename T>
+inline T astroid(const T x, const T y)
+{
+    const T p = x * x, q = y * y, r = (p + q - 1) / 6;
+    if (q == 0 && r <= 0)
+        return 0;
+    const T S = p * q / 4, r2 = r * r, r3 = r * r2;
+    const T disc = S * (S + 2 * r3);
+    T u = r;
+    if (disc >= 0) {
+        T T3 = S + r3;
+        T3 += T3 < 0 ? -std::sqrt(disc) : std::sqrt(disc);
+        const T t = std::cbrt(T3);
+        u += t + (t != 0 ? r2 / t : 0);
+    } else
+        u += 2 * r * std::cos(std::atan2(std::sqrt(-disc), -(S + r3)) / 3);
+    const T v = std::sqrt(u * u + q);
+    const T uv = u < 0 ? q / (v - u) : u + v;
+    const T w = (uv - q) / (2 * v);
+    return uv / (std::sqrt(uv + w * w) + w);
+}
+
+template <typename T>
+inline void normalise(T &s, T &c)
+{
+    const T n = std::hypot(s, c);
+    s /= n;
+    c /= n;
+}
+
+} // namespace detail
+
+template <typename T = double, typename E = WGS84>
+inline T spherical(const T lat1, const T lon1, const T lat2, const T lon2)
+{
+    return Constants<E, T>::r1 * detail::centralangle(lat1, lon1, lat2, lon2);
+}
+
+template <typename T = double, typename E = WGS84>
+inline T haversine(const T lat1, const T lon1, const T lat2, const T lon2)
+{
+    return detail::tableradius<E, T>((lat1 + lat2) / 2) * detail::centralangle(lat1, lon1, lat2, lon2);
+}
+
+// Newton's method on the azimuth from Karney's starting guesses, see
+// karneyiter() in geodesic.c
+template <typename T = double, typename E = WGS84>
+T karney(const T lat1_, const T lon1, const T lat2_, const T lon2)
+{
+    using C = Constants<E, T>;
+    if (detail::equal(lat1_, lat2_, C::eps) && detail::equal(lon1, lon2, C::eps))
+        return 0;
+    const T lambda12 = std::fabs(std::remainder(lon2 - lon1, 2 * C::pi));
+    const T slam = lambda12 == C::pi ? T(0) : std::sin(lambda12), clam = std::cos(lambda12);
+    T lat1 = lat1_, lat2 = lat2_;
+    if (std::fabs(lat1) < std::fabs(lat2)) {
+        const T t = lat1; lat1 = lat2; lat2 = t;
+    }
+    if (lat1 > 0) {
+        lat1 = -lat1;
+        lat2 = -lat2;
+    }
+    if (lat1 == 0 && lambda12 <= C::f1 * C::pi)
+        return C::a * lambda12;
+    const T tiny = std::sqrt(std::numeric_limits<T>::min());
+    T sb1 = C::f1 * std::sin(lat1), cb1 = std::cos(lat1);
+    T sb2 = C::f1 * std::sin(lat2), cb2 = std::cos(lat2);
+    detail::normalise(sb1, cb1);
+    detail::normalise(sb2, cb2);
+    cb1 = std::fmax(tiny, cb1);
+    cb2 = std::fmax(tiny, cb2);
+    if (cb1 < -sb1) {
+        if (cb2 == cb1)
+            sb2 = std::copysign(sb1, sb2);
+    } else if (std::fabs(sb2) == -sb1)
+        cb2 = cb1;
+
+    detail::Geodesic<T> g;
+    if (slam == 0) {
+        g = detail::geodesic<E, T>(sb1, cb1, sb2, cb2, slam, clam, slam, clam);
+        if (g.sig12 < 1 || g.m12 >= 0)
+            return g.dist;
+    }
+
+    const T sb12 = sb2 * cb1 - cb2 * sb1, cb12 = cb2 * cb1 + sb2 * sb1;
+    const T sb12a = sb2 * cb1 + cb2 * sb1;
+    T somg = slam, comg = clam;
+    if (cb12 >= 0 && sb12 < T(0.5) && cb2 * lambda12 < T(0.5)) {
+        const T s = sb1 + sb2, c = cb1 + cb2;
+        const T omg = lambda12 / (C::f1 * std::sqrt(1 + C::rf * s * s / (s * s + c * c)));
+        somg = std::sin(omg);
+        comg = std::cos(omg);
+    }
+    T sa1 = cb2 * somg;
+    T ca1 = comg >= 0 ? sb12 + cb2 * sb1 * somg * somg / (1 + comg)
+                      : sb12a - cb2 * sb1 * somg * somg / (1 - comg);
+    const T ssig12 = std::hypot(sa1, ca1), csig12 = sb1 * sb2 + cb1 * cb2 * comg;
+    if (csig12 < 0 && ssig12 < 6 * C::n * C::pi * cb1 * cb1) {
+        const T k2 = C::rf * sb1 * sb1, eps = k2 / (2 * (1 + std::sqrt(1 + k2)) + k2);
+        const T lamscale = C::f * cb1 * (1 - (1 - C::n) / 2 * eps) * C::pi;
+        const T x = std::atan2(-slam, -clam) / lamscale;
+        const T y = sb12a / (lamscale * cb1);
+        if (y > -200 * C::tol0 && x > -1 - 1000 * std::sqrt(C::tol0)) {
+            sa1 = std::fmin(T(1), -x);
+            ca1 = -std::sqrt(1 - sa1 * sa1);
+        } else {
+            const T k = detail::astroid(x, y);
+            const T omg = lamscale * -x * k / (1 + k);
+            somg = std::sin(omg);
+            comg = -std::cos(omg);
+            sa1 = cb2 * somg;
+            ca1 = sb12a - cb2 * sb1 * somg * somg / (1 - comg);
+        }
+    }
+    detail::normalise(sa1, ca1);
+
+    const T tolb = C::tol0 * std::sqrt(C::tol0);
+    T sa1a = tiny, ca1a = 1, sa1b = tiny, ca1b = -1;
+    bool tripn = false, tripb = false;
+    for (int i = 1;; ++i) {
+        g = detail::geodesic<E, T>(sb1, cb1, sb2, cb2, sa1, ca1, slam, clam);
+        if (tripb || !(std::fabs(g.eta) >= (tripn ? 8 : 1) * C::tol0) || i == C::maxiter)
+            break;
+        if (g.eta > 0 && (i > C::newton || ca1 / sa1 > ca1b / sa1b)) {
+            sa1b = sa1; ca1b = ca1;
+        } else if (g.eta < 0 && (i > C::newton || ca1 / sa1 < ca1a / sa1a)) {
+            sa1a = sa1; ca1a = ca1;
+        }
+        if (i <= C::newton && g.dv > 0) {
+            const T d = -g.eta / g.dv;
+            if (std::fabs(d) < C::pi) {
+                const T sd = std::sin(d), cd = std::cos(d), ns = sa1 * cd + ca1 * sd;
+                if (ns > 0) {
+                    ca1 = ca1 * cd - sa1 * sd;
+                    sa1 = ns;
+                    detail::normalise(sa1, ca1);
+                    tripn = std::fabs(g.eta) <= 16 * C::tol0;
+                    continue;
+                }
+            }
+        }
+        sa1 = (sa1a + sa1b) / 2;
+        ca1 = (ca1a + ca1b) / 2;
+        detail::normalise(sa1, ca1);
+        tripn = false;
+        tripb = std::fabs(sa1a - sa1) + (ca1a - ca1) < tolb || std::fabs(sa1 - sa1b) + (ca1 - ca1b) < tolb;
+    }
+    return g.dist;
+}
+
+template <typename T = double, typename E = WGS84>
+T vincenty(const T lat1, const T lon1, const T lat2, const T lon2)
+{
+    using C = Constants<E, T>;
+    if (detail::equal(lat1, lat2, C::eps) && detail::equal(lon1, lon2, C::eps))
+        return 0;
+    const T U1 = std::atan(C::f1 * std::tan(lat1));
+    const T U2 = std::atan(C::f1 * std::tan(lat2));
+    const T sU1 = std::sin(U1), cU1 = std::cos(U1);
+    const T sU2 = std::sin(U2), cU2 = std::cos(U2);
+    const T sU12 = sU1 * sU2, cU12 = cU1 * cU2;
+    T L = lon2 - lon1;
+    if (L > C::pi)
+        L -= 2 * C::pi;
+    else if (L < -C::pi)
+        L += 2 * C::pi;
+    T l = L, l0, ss, cs, s, c2a, c2sm;
+    int iter = 0;
+    do {
+        l0 = l;
+        const T sl = std::sin(l), cl = std::cos(l);
+        const T p = cU2 * sl;
+        const T q = cU1 * sU2 - sU1 * cU2 * cl;
+        ss = std::sqrt(p * p + q * q);
+        cs = sU12 + cU12 * cl;
+        s = std::atan2(ss, cs);
+        const T sa = cU12 * sl / ss;
+        c2a = 1 - sa * sa;
+        c2sm = c2a != 0 ? std::cos(s) - 2 * sU12 / c2a : 0;  // 0 on the equator
+        const T Cc = C::f16 * c2a * (4 + C::f * (4 - 3 * c2a));
+        l = L + (1 - Cc) * C::f * sa * (s + Cc * ss * (c2sm + Cc * cs * (-1 + 2 * c2sm * c2sm)));
+        // Nearly antipodal points: lambda runs past pi, or converges too slowly
+        if (!(std::fabs(l) <= C::pi) || ++iter >= C::vinciter)
+            return karney<T, E>(lat1, lon1, lat2, lon2);
+    } while (!detail::equal(l, l0, C::eps));
+    const T u2 = c2a * C::rf;
+    const T t = std::sqrt(1 + u2);
+    const T k1 = (t - 1) / (t + 1);
+    const T k24 = T(0.25) * k1 * k1;
+    const T A = (1 + k24) / (1 - k1);
+    const T B = k1 * (1 - T(1.5) * k24);
+    const T ds = B * ss * (c2sm + (B / 4) * (cs * (-1 + 2 * c2sm * c2sm) - (B / 6) * c2sm * (-3 + 4 * ss * ss) * (-3 + 4 * c2sm * c2sm)));
+    return C::b * A * (s - ds);
+}
+
+// Flat-earth scale around a reference latitude, keep one per track for the
+// adaptive method; see adaptive() in geodesic.c
+template <typename T = double, typename E = WGS84>
+class Adaptive {
+public:
+    explicit Adaptive(const T tol = T(1e-3)) : tol_(tol) {}
+
+    T operator()(const T lat1, const T lon1, const T lat2, const T lon2)
+    {
+        using C = Constants<E, T>;
+        const T lat = (lat1 + lat2) / 2;
+        T dl = lat - lat_;
+        if (!(std::fabs(dl) <= C::latspan)) {
+            setscale(lat);
+            dl = 0;
+        }
+        T dlon = lon2 - lon1;
+        if (dlon > C::pi)
+            dlon -= 2 * C::pi;
+        else if (dlon < -C::pi)
+            dlon += 2 * C::pi;
+        const T x = (kx_ + dkx_ * dl) * dlon;
+        const T y = (ky_ + dky_ * dl) * (lat2 - lat1);
+        const T d2 = x * x + y * y;
+        const T d = std::sqrt(d2);
+        if (d * (dl * dl + t2_ * d2 / (24 * C::b2)) > tol_)
+            return vincenty<T, E>(lat1, lon1, lat2, lon2);
+        return d;
+    }
+
+private:
+    void setscale(const T lat)
+    {
+        using C = Constants<E, T>;
+        const T s = std::sin(lat), c = std::cos(lat);
+        const T w2 = 1 - C::e2 * s * s;
+        const T N = C::a / std::sqrt(w2);
+        const T M = N * (1 - C::e2) / w2;
+        lat_ = lat;
+        kx_ = N * c;
+        ky_ = M;
+        dkx_ = N * s * (C::e2 * c * c / w2 - 1);
+        dky_ = 3 * M * C::e2 * s * c / w2;
+        t2_ = 1 + 2 * s * s / (c * c);
+    }
+
+    T tol_;
+    T lat_ = std::numeric_limits<T>::quiet_NaN();
+    T kx_ = 0, ky_ = 0, dkx_ = 0, dky_ = 0, t2_ = 0;
+};
+
+// Distance with method M for one segment; Adaptive starts a new local scale every call
+template <Method M, typename T = double, typename E = WGS84>
+inline T distance(const T lat1, const T lon1, const T lat2, const T lon2, const T tol = T(1e-3))
+{
+    if constexpr (M == Method::Spherical)
+        return spherical<T, E>(lat1, lon1, lat2, lon2);
+    else if constexpr (M == Method::Haversine)
+        return haversine<T, E>(lat1, lon1, lat2, lon2);
+    else if constexpr (M == Method::Adaptive)
+        return Adaptive<T, E>(tol)(lat1, lon1, lat2, lon2);
+    else if constexpr (M == Method::Vincenty)
+        return vincenty<T, E>(lat1, lon1, lat2, lon2);
+    else
+        return karney<T, E>(lat1, lon1, lat2, lon2);
+}
+
+// Distances from point i-1 to point i along a path of n points (dist[0] = 0)
+template <Method M, typename T = double, typename E = WGS84>
+void path(const T *lat, const T *lon, const std::size_t n, T *dist, const T tol = T(1e-3))
+{
+    if (!n)
+        return;
+    dist[0] = 0;
+    if constexpr (M == Method::Adaptive) {
+        Adaptive<T, E> adaptive(tol);
+        for (std::size_t i = 1; i < n; ++i)
+            dist[i] = adaptive(lat[i - 1], lon[i - 1], lat[i], lon[i]);
+    } else
+        for (std::size_t i = 1; i < n; ++i)
+            dist[i] = distance<M, T, E>(lat[i - 1], lon[i - 1], lat[i], lon[i]);
+}
+
+} // namespace gpx
+
+#endif
@@ -0,0 +1,495 @@
+/*****************************************************************************
+ * GPX FILTER
+ * Streams track points from a file or stdin to stdout with bounded memory,
+ * for use in shell pipelines (zcat big.gpx.gz | gpxfilter -o dist | ...):
+ *
+ *     gpxfilter [-i gpx|text|bin] [-o dist|text|gpx] [-m method] [-t tolerance]
+ *               [-s speed] [-T start] [-r] [-D shift] [-S scale] [-F]
+ *               [-d demdir] [-e filter[:param]] [file]
+ *
+ * Input (default: gpx if it starts with '<', else text):
+ *
+ *     gpx   track points of a GPX file
+ *     text  one point per line as "lat lon" or "lat,lon" in decimal degrees;
+ *           empty lines and lines starting with '#' are skipped
+ *     bin   pairs of doubles lat,lon in native byte order, 16 bytes per point
+ *
+ * Output (default dist):
+ *
+ *     dist  distance in metres from the previous point, one line per point
+ *     text  lat lon distance total, one line per point
+ *     gpx   GPX track
+ *
+ * Distances with the chosen method (default adaptive, see greatcircledist),
+ * 0 at the first point of every GPX trkseg so gaps are not counted; GPX
+ * output keeps the trk and trkseg elements.
+ * With -s speed in km/h every point gets a new timestamp at constant speed
+ * from the start time -T (ISO-8601, default: time of the first point, or now
+ * if it has none). Totals are compensated sums; with -r they are the
+ * reproducible sums of the library (gpx_cumulative_repro), bit-identical to
+ * the same distances summed on any number of threads or machines.
+ * Existing timestamps can be edited instead: -D shifts them by seconds or
+ * [+-]HH:MM[:SS], -S multiplies the durations since the first one by a
+ * factor (0.5 = twice as fast), -F fills in missing times within a segment
+ * in proportion to the distance between the timed points around them.
+ * With -d the elevations are replaced by those of the SRTM .hgt tiles in
+ * demdir (see dem.h) where it has data, before any smoothing.
+ * With -e the elevations are smoothed on the way through with sg, median or
+ * kalman (see smooth.h), e.g. -e sg:7; only GPX output shows them.
+ *
+ * Three threads work as a pipeline on blocks of BLOCKPOINTS points: the
+ * main thread reads and parses (with decompression on a fourth thread for
+ * compressed input), one thread calculates distances and timestamps, one
+ * formats and writes the output. For the centred elevation filters and for
+ * filling in times the compute stage holds on to a block until the values
+ * of its last points are known from the next one; times of a gap longer
+ * than that stay missing. Blocks go round through lock-free SPSC
+ * queues, parsed -> computed -> free -> parsed, so memory use is fixed at
+ * NBLOCKS blocks whatever the input size.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>    // printf, fprintf, fwrite
+#include <stdlib.h>   // realloc, free, exit, strtod
+#include <math.h>     // llround, NAN
+#include <string.h>   // strcmp, memchr, memcpy, strlen
+#include <time.h>     // time
+#include <unistd.h>   // getopt
+#include <pthread.h>  // pthread_create, pthread_join
+#include "gpxio.h"
+#include "input.h"
+#include "queue.h"
+#include "parallel.h"
+#include "smooth.h"
+#include "dem.h"
+#include "timeedit.h"
+
+#define BLOCKPOINTS 65536              // points per block of output
+#define NBLOCKS     4                  // blocks in the pipeline (power of 2)
+#define SLICE       ((size_t)1 << 20)  // bytes of GPX per parser call
+
+enum { IN_AUTO, IN_GPX, IN_TEXT, IN_BIN };
+enum { OUT_DIST, OUT_TEXT, OUT_GPX };
+
+// Points handed from stage to stage
+typedef struct {
+    Track trk;      // after the first block, point 0 is the last point of the previous block
+    size_t first;   // first new point: 0 or 1
+    double *dist;   // segment distances
+    size_t distcap;
+    bool last;      // end of input
+} Block;
+
+typedef struct {
+    int in, out;
+    Method method;
+    double tol;
+    double speed;      // m/s, 0 = keep timestamps
+    int64_t start;     // NOTIME = from the first point
+    bool repro;        // reproducible totals
+    Dem dem;           // elevation model, dem.dir = NULL if none
+    Smoother smooth;   // elevation filter of the compute stage
+    TimeEdit edit;     // edits of existing timestamps
+    bool edittimes;    // any edit on
+    Block block[NBLOCKS];
+    Queue parsed, computed, free;
+    Block *cur;        // block being filled by the reader
+    size_t line;       // text input line number
+    GpxParser parser;
+} Filter;
+
+static void fail(const char *msg)
+{
+    fprintf(stderr, "%s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+static void push(Filter *f, const int32_t lat, const int32_t lon)
+{
+    if (!trackpush(&f->cur->trk, lat, lon, NAN, NOTIME))
+        fail("Out of memory.");
+}
+
+// Running total of the distances
+typedef struct {
+    KahanSum fast;
+    ReproSum repro;
+} Total;
+
+static double addtotal(const Filter *f, Total *t, const double x)
+{
+    if (f->repro)
+        return reproadd(&t->repro, x);
+    kahanadd(&t->fast, x);
+    return kahantotal(t->fast);
+}
+
+// Pass the current block on and continue in a free one, starting with the
+// last point so that no segment is lost between blocks
+static void handoff(Filter *f, const bool last)
+{
+    Block *b = f->cur;
+    b->last = last;
+    if (!last && b->trk.len <= b->first)
+        return;  // nothing new yet
+    const Track *t = &b->trk;
+    if (!t->len) {  // no points at all
+        queuepush(&f->parsed, b);
+        return;
+    }
+    const size_t end = t->len - 1;
+    const int32_t lat = t->lat[end], lon = t->lon[end];
+    const double ele = t->ele[end];
+    const int64_t time = t->time[end];
+    // A segment opened after the last point starts at the first new point. A
+    // trk opened after it, with or without a segment yet, carries over as an
+    // index relative to the trk of the last point.
+    const Segment *s = t->nseg && t->seg[t->nseg - 1].first == t->len ? &t->seg[t->nseg - 1] : NULL;
+    const size_t base = t->nseg ? t->seg[t->nseg - 1 - (s != NULL)].trk : 0;
+    const size_t opentrk = (t->ntrk ? t->ntrk - 1 : 0) - base;
+    const bool newseg = s != NULL;
+    const size_t segtrk = s ? s->trk - base : 0;
+    queuepush(&f->parsed, b);
+    if (last)
+        return;
+    f->cur = b = queuepop(&f->free);
+    trackclear(&b->trk);
+    b->trk.ntrk = 1 + opentrk;  // trk indices relative to the one of point 0
+    trackpush(&b->trk, lat, lon, ele, time);
+    if (newseg && !trackaddseg(&b->trk, 1, segtrk))
+        fail("Out of memory.");
+    b->first = 1;
+    f->parser.trk = &b->trk;
+}
+
+// Elevations of the new points, the filter starts again at every segment
+static void smoothblock(Filter *f, Block *b)
+{
+    Track *t = &b->trk;
+    size_t i = b->first;
+    for (size_t s = 0; s < t->nseg; ++s) {
+        const size_t first = t->seg[s].first;
+        if (first < i)
+            continue;
+        if (first >= t->len)
+            break;
+        smoothpush(&f->smooth, t->ele + i, first - i);
+        smoothflush(&f->smooth);
+        i = first;
+    }
+    smoothpush(&f->smooth, t->ele + i, t->len - i);
+}
+
+// Edits of the times of the new points
+static void editblock(Filter *f, Block *b)
+{
+    Track *t = &b->trk;
+    size_t s = 0;
+    while (s < t->nseg && t->seg[s].first < b->first)
+        ++s;
+    for (size_t i = b->first; i < t->len; ++i) {
+        bool newseg = false;
+        for (; s < t->nseg && t->seg[s].first == i; ++s)
+            newseg = true;
+        if (!timeeditpoint(&f->edit, &t->time[i], b->dist[i], newseg))
+            fail("Out of memory.");
+    }
+}
+
+// Pipeline stage: distances, timestamps and elevations
+static void *compute(void *arg)
+{
+    Filter *f = arg;
+    Total total = {0};
+    Block *held = NULL;  // previous block, with smoothed values or times still pending
+    const bool hold = f->smooth.kind != SMOOTH_NONE || f->edit.fill;
+    for (;;) {
+        Block *b = queuepop(&f->parsed);
+        Track *t = &b->trk;
+        if (t->len > b->first) {
+            if (b->distcap < t->len) {
+                free(b->dist);
+                if (!(b->dist = malloc(t->cap * sizeof *b->dist)))
+                    fail("Out of memory.");
+                b->distcap = t->cap;
+            }
+            trackdistances(t, f->method, f->tol, b->dist);
+            for (size_t i = 1; i < t->nseg; ++i)
+                if (t->seg[i].first < t->len)
+                    b->dist[t->seg[i].first] = 0;
+            if (f->speed > 0) {
+                if (f->start == NOTIME)
+                    f->start = t->time[0] != NOTIME ? t->time[0] : (int64_t)time(NULL) * 1000;
+                for (size_t i = b->first; i < t->len; ++i)
+                    t->time[i] = f->start + llround(addtotal(f, &total, b->dist[i]) * (1000 / f->speed));
+            }
+        }
+        if (f->dem.dir)
+            demtrack(&f->dem, t, b->first, t->len - b->first);
+        if (f->smooth.kind != SMOOTH_NONE)
+            smoothblock(f, b);
+        if (f->edittimes && t->len > b->first)
+            editblock(f, b);
+        if (hold) {
+            if (b->last)
+                smoothflush(&f->smooth);
+            if (held) {
+                // Only a block with fewer elevations than the half window
+                // leaves values of the previous one pending: end the run there
+                const double *p = smoothpending(&f->smooth);
+                if (p && p >= held->trk.ele && p < held->trk.ele + held->trk.len)
+                    smoothflush(&f->smooth);
+                timeeditdrop(&f->edit, held->trk.time, held->trk.len);
+                queuepush(&f->computed, held);
+            }
+            held = b;
+            if (!b->last)
+                continue;
+        }
+        const bool last = b->last;
+        queuepush(&f->computed, b);
+        if (last)
+            return NULL;
+    }
+}
+
+static void writebuf(TextBuffer *out)
+{
+    fwrite(out->buf, 1, out->len, stdout);
+    out->len = 0;
+}
+
+// Pipeline stage: output
+static void *writer(void *arg)
+{
+    Filter *f = arg;
+    TextBuffer out = {0};
+    Total total = {0};
+    if (f->out == OUT_GPX) {
+        if (!gpxformathead(&out))
+            fail("Out of memory.");
+        writebuf(&out);
+    }
+    for (;;) {
+        Block *b = queuepop(&f->computed);
+        const Track *t = &b->trk;
+        if (f->out == OUT_GPX) {
+            if (!gpxformatpoints(t, b->first, t->len - b->first, &out))
+                fail("Out of memory.");
+            writebuf(&out);
+        } else
+            for (size_t i = b->first; i < t->len; ++i) {
+                if (f->out == OUT_DIST)
+                    printf("%.3f\n", b->dist[i]);
+                else
+                    printf("%.7f %.7f %.3f %.3f\n", e7deg(t->lat[i]), e7deg(t->lon[i]), b->dist[i],
+                        addtotal(f, &total, b->dist[i]));
+            }
+        const bool last = b->last;
+        queuepush(&f->free, b);
+        if (last)
+            break;
+    }
+    if (f->out == OUT_GPX) {
+        if (!gpxformatfoot(&out))
+            fail("Out of memory.");
+        writebuf(&out);
+    }
+    free(out.buf);
+    return NULL;
+}
+
+// GPX in slices so that a mapped file of any size is parsed block by block
+static size_t gpxchunk(Filter *f, const char *buf, const size_t len, const bool last)
+{
+    size_t used = 0, slice = SLICE;
+    while (used < len) {
+        const size_t n = len - used < slice ? len - used : slice;
+        const bool final = last && used + n == len;
+        const size_t k = gpxparse(&f->parser, buf + used, n, final);
+        if (f->parser.oom)
+            fail("Out of memory.");
+        if (f->cur->trk.len >= BLOCKPOINTS)
+            handoff(f, false);
+        if (!k && !final) {
+            if (used + n == len)
+                break;  // rest goes with the next chunk
+            slice *= 2;  // one element longer than a slice
+            continue;
+        }
+        used += k;
+    }
+    return used;
+}
+
+// One text line: two numbers separated by white space or a comma
+static void textline(Filter *f, const char *s, const char *e)
+{
+    f->line++;
+    while (s < e && (*s == ' ' || *s == '\t' || *s == '\r')) ++s;
+    if (s == e || *s == '#')
+        return;
+    const char *sep = s;
+    while (sep < e && *sep != ' ' && *sep != '\t' && *sep != ',') ++sep;
+    const char *t = sep;
+    while (t < e && (*t == ' ' || *t == '\t' || *t == ',')) ++t;
+    int32_t lat, lon;
+    if (!parselat(s, sep, &lat) || !parsee7(t, e, &lon)) {
+        fprintf(stderr, "Invalid coordinates on line %zu.\n", f->line);
+        exit(EXIT_FAILURE);
+    }
+    push(f, lat, lon);
+}
+
+static size_t textchunk(Filter *f, const char *buf, const size_t len, const bool last)
+{
+    const char *s = buf, *end = buf + len, *nl;
+    while ((nl = memchr(s, '\n', end - s))) {
+        textline(f, s, nl);
+        s = nl + 1;
+        if (f->cur->trk.len >= BLOCKPOINTS)
+            handoff(f, false);
+    }
+    if (last && s < end) {
+        textline(f, s, end);
+        s = end;
+    }
+    return (size_t)(s - buf);
+}
+
+static size_t binchunk(Filter *f, const char *buf, const size_t len, const bool last)
+{
+    size_t i = 0;
+    for (; i + 2 * sizeof(double) <= len; i += 2 * sizeof(double)) {
+        double c[2];
+        memcpy(c, buf + i, sizeof c);
+        push(f, late7(c[0]), toe7(c[1]));
+        if (f->cur->trk.len >= BLOCKPOINTS)
+            handoff(f, false);
+    }
+    if (last && i < len)
+        fail("Incomplete point at end of binary input.");
+    return last ? len : i;
+}
+
+static size_t consume(void *ctx, const char *buf, const size_t len, const bool last)
+{
+    Filter *f = ctx;
+    if (f->in == IN_AUTO) {
+        size_t i = 0;
+        while (i < len && (buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\r' || buf[i] == '\n'))
+            ++i;
+        if (i == len && !last)
+            return 0;
+        f->in = i < len && buf[i] == '<' ? IN_GPX : IN_TEXT;
+    }
+    switch (f->in) {
+        case IN_GPX: return gpxchunk(f, buf, len, last);
+        case IN_TEXT: return textchunk(f, buf, len, last);
+        default: return binchunk(f, buf, len, last);
+    }
+}
+
+static int choice(const char *val, const char *const *names, const int n, const char *what)
+{
+    for (int i = 0; i < n; ++i)
+        if (!strcmp(val, names[i]))
+            return i;
+    fprintf(stderr, "Unknown %s: %s.\n", what, val);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *const innames[] = {"auto", "gpx", "text", "bin"};
+    static const char *const outnames[] = {"dist", "text", "gpx"};
+    Filter f = {.in = IN_AUTO, .out = OUT_DIST, .method = ADAPTIVE, .tol = TOLERANCE, .start = NOTIME};
+    int opt;
+    char *end;
+    int64_t shift = 0;
+    double scale = 1;
+    bool fill = false;
+    while ((opt = getopt(argc, argv, "i:o:m:t:s:T:rD:S:Fd:e:")) != -1) {
+        switch (opt) {
+            case 'i': f.in = choice(optarg, innames, 4, "input format"); break;
+            case 'o': f.out = choice(optarg, outnames, 3, "output format"); break;
+            case 'm': f.method = (Method)choice(optarg, methodname, METHODS, "method"); break;
+            case 't':
+                f.tol = strtod(optarg, &end);
+                if (*end || !(f.tol > 0))
+                    fail("Tolerance must be a positive number of metres.");
+                break;
+            case 's':
+                f.speed = strtod(optarg, &end) / 3.6;
+                if (*end || !(f.speed > 0))
+                    fail("Speed must be a positive number of km/h.");
+                break;
+            case 'T':
+                if (!parseisotime(optarg, optarg + strlen(optarg), &f.start))
+                    fail("Start time must be ISO-8601, e.g. 2023-03-24T10:00:00Z.");
+                break;
+            case 'r': f.repro = true; break;
+            case 'D':
+                if (!parsetimeshift(optarg, &shift))
+                    fail("Shift must be seconds or [+-]HH:MM[:SS].");
+                break;
+            case 'S':
+                scale = strtod(optarg, &end);
+                if (*end || !(scale > 0))
+                    fail("Scale must be a positive factor.");
+                break;
+            case 'F': fill = true; break;
+            case 'd':
+                demclose(&f.dem);
+                if (!demopen(&f.dem, optarg))
+                    fail("Out of memory.");
+                break;
+            case 'e':
+                if (!smoothparse(&f.smooth, optarg))
+                    fail("Unknown filter or parameter out of range.");
+                break;
+            default:
+                fail("Usage: gpxfilter [-i gpx|text|bin] [-o dist|text|gpx] [-m method] [-t tolerance]\n"
+                     "                 [-s speed] [-T start] [-r] [-D shift] [-S scale] [-F]\n"
+                     "                 [-d demdir] [-e filter[:param]] [file]");
+        }
+    }
+    timeeditinit(&f.edit, shift, scale, fill);
+    f.edittimes = shift || scale != 1 || fill;
+    if (f.edittimes && f.speed > 0)
+        fail("Speed -s replaces all times, it cannot be combined with -D, -S or -F.");
+    const char *fname = optind < argc ? argv[optind] : "-";
+
+    if (!queueinit(&f.parsed, NBLOCKS) || !queueinit(&f.computed, NBLOCKS) || !queueinit(&f.free, NBLOCKS))
+        fail("Out of memory.");
+    for (int i = 0; i < NBLOCKS; ++i) {
+        if (!trackreserve(&f.block[i].trk, BLOCKPOINTS + 1))
+            fail("Out of memory.");
+        if (i)
+            queuepush(&f.free, &f.block[i]);
+    }
+    f.cur = &f.block[0];
+    gpxinit(&f.parser, &f.cur->trk);
+
+    pthread_t computethread, writethread;
+    if (pthread_create(&computethread, NULL, compute, &f) || pthread_create(&writethread, NULL, writer, &f))
+        fail("Could not start threads.");
+    if (!streaminput(fname, consume, &f))
+        fail("Could not read input.");
+    handoff(&f, true);
+    pthread_join(computethread, NULL);
+    pthread_join(writethread, NULL);
+
+    for (int i = 0; i < NBLOCKS; ++i) {
+        trackfree(&f.block[i].trk);
+        free(f.block[i].dist);
+    }
+    demclose(&f.dem);
+    timeeditfree(&f.edit);
+    queuefree(&f.parsed);
+    queuefree(&f.computed);
+    queuefree(&f.free);
+    return fflush(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
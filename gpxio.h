@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * GPX READER AND WRITER
+ * Track points (trkpt) with lat/lon attributes and optional ele and time
+ * elements, and in the same pass waypoints (wpt) and route points (rtept)
+ * with their names. The reader is incremental: feed it any number of
+ * consecutive buffers and it keeps its state between them, so a file can be
+ * read in chunks of any size. Everything else is skipped.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef GPXIO_H_
+#define GPXIO_H_
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int64_t
+#include <stdbool.h>  // bool
+#include "track.h"
+#include "waypoints.h"
+
+#define NAMELEN 256  // longest waypoint name kept, in bytes including the NUL
+
+// Incremental GPX parser state
+typedef struct {
+    Track *trk;      // points are appended here; NULL = tokenize only, no number parsing
+    Waypoints *wpt;  // waypoints are appended here, NULL = skip (set after gpxinit)
+    Waypoints *rte;  // route points, one trk and segment per rte element; NULL = skip
+    size_t points;   // number of track points seen
+    bool oom;        // out of memory while appending points
+    bool inpoint;    // inside trkpt, wpt or rtept element
+    int kind;        // which one
+    int text;        // element of the text content that comes next
+    int32_t lat, lon;  // point under construction
+    double ele;
+    int64_t time;
+    size_t namelen;  // name of a waypoint or route point, NONAME if none
+    char name[NAMELEN];
+} GpxParser;
+
+// Growing output buffer for the writers
+typedef struct {
+    char *buf;
+    size_t len, cap;
+} TextBuffer;
+
+// Start parsing into track t (NULL = tokenize only)
+void gpxinit(GpxParser *p, Track *t);
+
+// Parse as much of buf[0..len) as possible and return the number of bytes
+// consumed. Unconsumed bytes at the end are an incomplete tag or text: pass
+// them again at the start of the next buffer. With last=true, the buffer is
+// the end of the input and everything is consumed.
+size_t gpxparse(GpxParser *p, const char *buf, const size_t len, const bool last);
+
+// Decimal number without exponent from s to e, false if not a number
+bool parsedecimal(const char *s, const char *e, double *x);
+
+// Coordinate in degrees from s to e as fixed point 1e-7 degrees, exact up to 7
+// decimals and rounded half away from zero beyond that; false if not a number
+// or out of range
+bool parsee7(const char *s, const char *e, int32_t *x);
+
+// The same for a latitude, also false beyond the poles and then x is unchanged
+bool parselat(const char *s, const char *e, int32_t *x);
+
+// Parse a whole buffer into the track on up to nthreads threads (0 = all
+// processors) by splitting it into byte ranges that start at a trkpt tag.
+// Ranges are parsed independently and appended in order; if a split turns
+// out to be inside a comment or CDATA, the buffer is parsed again serially.
+// False if out of memory.
+bool gpxparsemt(const char *buf, const size_t len, const int nthreads, Track *t);
+
+// ISO-8601 date and time from s to e as ms since the Unix epoch, false if invalid
+// Format: YYYY-MM-DDTHH:MM:SS[.sss][Z|+hh:mm|-hh:mm|+hhmm|-hhmm], the day
+// within the month and no leap second
+bool parseisotime(const char *s, const char *e, int64_t *ms);
+
+// Whole file in memory, NULL if it could not be read; size is set to the number of bytes
+char *readfile(const char *fname, size_t *size);
+
+// Buffer to file, false on error
+bool writefile(const char *fname, const char *buf, const size_t len);
+
+// Parse a whole file ("-" = stdin) with the parser: memory mapped if
+// possible, else in large chunks; false if the file could not be read
+bool gpxstream(GpxParser *p, const char *fname);
+
+// Append all track points of a GPX file ("-" = stdin) to the track, false on error
+bool gpxread(const char *fname, Track *t);
+
+// Room for n more bytes in the buffer, false if out of memory
+bool bufreserve(TextBuffer *out, const size_t n);
+
+// Append the track as GPX text to the buffer, false if out of memory. Points
+// without lat or lon are left out because GPX requires both.
+bool gpxformat(const Track *t, TextBuffer *out);
+
+// The same in pieces for streaming output: document header, points
+// [first, first+n) of the track, footer
+bool gpxformathead(TextBuffer *out);
+bool gpxformatpoints(const Track *t, const size_t first, const size_t n, TextBuffer *out);
+bool gpxformatfoot(TextBuffer *out);
+
+// Write the track as a GPX file, false on error
+bool gpxwrite(const char *fname, const Track *t);
+
+#endif
@@ -0,0 +1,605 @@
+/*****************************************************************************
+ * GPX READER
+ * See gpxio.h. Hand-written tokenizer, not a validating XML parser: it finds
+ * tags with memchr, only looks at the attributes of trkpt, wpt and rtept and
+ * only converts the text of ele, time and name inside them. Opening trk and
+ * trkseg tags mark segment boundaries in the track, rte tags in the routes.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>    // fopen, fread, fclose
+#include <stdlib.h>   // malloc, free, strtod
+#include <string.h>   // memchr, memcmp, memcpy
+#include <math.h>     // NAN
+#include "gpxio.h"
+#include "input.h"
+#include "parallel.h"
+
+#define NUMLEN   64                  // longest number handed to strtod
+#define MINRANGE ((size_t)1 << 20)   // bytes per thread worth starting a thread for
+
+// Text content to convert
+enum { TEXT_NONE, TEXT_ELE, TEXT_TIME, TEXT_NAME };
+
+// Point elements
+enum { POINT_TRK, POINT_WPT, POINT_RTE };
+static const char *const pointtag[] = {"trkpt", "wpt", "rtept"};
+static const size_t pointtaglen[] = {5, 3, 5};
+
+// Exact powers of ten as doubles
+static const double pow10tab[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool isspc(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Tag name s..e equal to name?
+static bool isname(const char *s, const char *e, const char *name, const size_t len)
+{
+    return (size_t)(e - s) == len && !memcmp(s, name, len);
+}
+
+// Find the 3-character terminator of a comment or CDATA section
+static const char *findend(const char *s, const char *end, const char *term)
+{
+    for (; s + 3 <= end; ++s) {
+        s = memchr(s, term[0], end - s);
+        if (!s || s + 3 > end)
+            return NULL;
+        if (s[1] == term[1] && s[2] == term[2])
+            return s;
+    }
+    return NULL;
+}
+
+bool parsedecimal(const char *s, const char *e, double *x)
+{
+    while (s < e && isspc(*s)) ++s;
+    while (e > s && isspc(e[-1])) --e;
+    if (s == e)
+        return false;
+    const char *start = s;
+    bool neg = *s == '-';
+    if (*s == '-' || *s == '+')
+        ++s;
+    uint64_t mant = 0;
+    int any = 0, digits = 0, frac = -1;  // frac = -1: no decimal point yet
+    for (; s < e; ++s) {
+        if (*s >= '0' && *s <= '9') {
+            ++any;
+            if (mant || *s != '0')
+                ++digits;
+            mant = mant * 10 + (uint64_t)(*s - '0');
+            if (frac >= 0)
+                ++frac;
+        } else if (*s == '.' && frac < 0)
+            frac = 0;
+        else
+            break;
+    }
+    if (!any)
+        return false;
+    if (s < e || digits > 15 || frac > 22) {
+        // Exponent, garbage or too many digits for the exact fast path
+        char tmp[NUMLEN];
+        size_t n = (size_t)(e - start);
+        if (n >= NUMLEN)
+            return false;
+        memcpy(tmp, start, n);
+        tmp[n] = '\0';
+        char *end;
+        *x = strtod(tmp, &end);
+        return end == tmp + n && end != tmp;
+    }
+    // Mantissa and power of ten are both exact so the division rounds correctly
+    double val = frac > 0 ? (double)mant / pow10tab[frac] : (double)mant;
+    *x = neg ? -val : val;
+    return true;
+}
+
+bool parsee7(const char *s, const char *e, int32_t *x)
+{
+    while (s < e && isspc(*s)) ++s;
+    while (e > s && isspc(e[-1])) --e;
+    if (s == e)
+        return false;
+    const char *start = s;
+    bool neg = *s == '-';
+    if (*s == '-' || *s == '+')
+        ++s;
+    int64_t v = 0;
+    int any = 0, frac = -1, roundup = 0;
+    for (; s < e; ++s) {
+        if (*s >= '0' && *s <= '9') {
+            ++any;
+            if (frac < 7) {
+                v = v * 10 + (*s - '0');
+                if (v > 180LL * E7)
+                    return false;
+                if (frac >= 0)
+                    ++frac;
+            } else if (frac == 7) {
+                roundup = *s >= '5';  // only the first dropped digit decides
+                frac = 8;
+            }
+        } else if (*s == '.' && frac < 0)
+            frac = 0;
+        else
+            break;
+    }
+    if (!any)
+        return false;
+    if (s < e) {
+        // Exponent or garbage
+        double deg;
+        if (!parsedecimal(start, e, &deg) || (*x = toe7(deg)) == NOCOOR)
+            return false;
+        return true;
+    }
+    for (int i = frac < 0 ? 0 : frac; i < 7; ++i)
+        v *= 10;
+    v += roundup;
+    if (v > 180LL * E7)
+        return false;
+    *x = (int32_t)(neg ? -v : v);
+    return true;
+}
+
+bool parselat(const char *s, const char *e, int32_t *x)
+{
+    int32_t v;
+    if (!parsee7(s, e, &v) || v < -90 * E7 || v > 90 * E7)
+        return false;
+    *x = v;
+    return true;
+}
+
+// Fixed number of digits as int, false if not all digits
+static bool digits(const char *s, const int n, int *val)
+{
+    *val = 0;
+    for (int i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        *val = *val * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar
+// Ref.: https://howardhinnant.github.io/date_algorithms.html#days_from_civil
+static int64_t daysfromcivil(int y, const int m, const int d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - (int)(era * 400);
+    const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// The 8 bytes at s as a little-endian word, one load on most machines
+static inline uint64_t word8(const char *s)
+{
+    uint64_t w;
+    memcpy(&w, s, sizeof w);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+// All bytes of word w under mask m are ASCII digits: high nibble 3 before
+// and after adding 6 (a byte that is not a digit may carry into the next,
+// but then it fails itself)
+static inline bool worddigits(const uint64_t w, const uint64_t m)
+{
+    const uint64_t hi = 0xF0F0F0F0F0F0F0F0u;
+    const uint64_t t = (w & hi) | ((w + 0x0606060606060606u) & hi) >> 4;
+    return (t & m) == (0x3333333333333333u & m);
+}
+
+// Byte i of a word
+#define BYTE(w, i) ((int)((w) >> ((i) * 8) & 0xFF))
+
+bool parseisotime(const char *s, const char *e, int64_t *ms)
+{
+    while (s < e && isspc(*s)) ++s;
+    while (e > s && isspc(e[-1])) --e;
+    if (e - s < 19)
+        return false;
+    // "YYYY-MM-" and "DDTHH:MM" as two words, checked and converted in place
+    const uint64_t w1 = word8(s), w2 = word8(s + 8);
+    const uint64_t sep1 = 0xFF0000FF00000000u, dig1 = ~sep1;  // bytes 4 and 7
+    const uint64_t sep2 = 0x0000FF0000FF0000u, dig2 = ~sep2;  // bytes 2 and 5
+    // Without branches: a chain of them makes the compiler treat the rest as cold
+    const bool form = ((w1 & sep1) == ((uint64_t)'-' << 56 | (uint64_t)'-' << 32))
+        & (((w2 & sep2) == ((uint64_t)':' << 40 | (uint64_t)'T' << 16))
+            | ((w2 & sep2) == ((uint64_t)':' << 40 | (uint64_t)' ' << 16)))
+        & (s[16] == ':') & ((unsigned)(s[17] - '0') <= 9) & ((unsigned)(s[18] - '0') <= 9)
+        & worddigits(w1, dig1) & worddigits(w2, dig2);
+    if (!form)
+        return false;
+    // Digit values with the separators at 0 (so no byte borrows), then every
+    // byte times 10 plus the next: two-digit numbers at the first of each pair
+    const uint64_t zero = 0x3030303030303030u;
+    const uint64_t d1 = (w1 & dig1) - (zero & dig1), d2 = (w2 & dig2) - (zero & dig2);
+    const uint64_t p1 = d1 * 10 + (d1 >> 8), p2 = d2 * 10 + (d2 >> 8);
+    const int y = BYTE(p1, 0) * 100 + BYTE(p1, 2), mo = BYTE(p1, 5);
+    const int d = BYTE(p2, 0), h = BYTE(p2, 3), mi = BYTE(p2, 6);
+    const int sec = (s[17] - '0') * 10 + (s[18] - '0');
+    // Days in the month from two bits per month, plus one in February of a leap year
+    const bool leap = (y % 4 == 0) & ((y % 100 != 0) | (y % 400 == 0));
+    const int mdays = 28 + (0x3BBEECC >> (mo * 2) & 3) + ((mo == 2) & leap);
+    if ((mo < 1) | (mo > 12) | (d < 1) | (d > mdays) | (h > 24) | ((h == 24) & ((mi | sec) != 0))
+        | (mi > 59) | (sec > 59))
+        return false;
+    s += 19;
+    int frac = 0;
+    if (s < e && *s == '.') {
+        int scale = 100;
+        for (++s; s < e && *s >= '0' && *s <= '9'; ++s, scale /= 10)
+            frac += (*s - '0') * scale;  // milliseconds, further digits truncated
+    }
+    int offset = 0;  // minutes east of UTC
+    if (s < e && *s == 'Z')
+        ++s;
+    else if (s < e && (*s == '+' || *s == '-')) {
+        // Extended +hh:mm or basic +hhmm
+        const int colon = e - s >= 6 && s[3] == ':';
+        int oh, om;
+        if (e - s < 5 + colon || !digits(s + 1, 2, &oh) || !digits(s + 3 + colon, 2, &om) || om > 59)
+            return false;
+        offset = (*s == '-' ? -1 : 1) * (oh * 60 + om);
+        s += 5 + colon;
+    }
+    if (s != e)
+        return false;
+    *ms = ((daysfromcivil(y, mo, d) * 86400 + h * 3600 + (mi - offset) * 60 + sec) * 1000) + frac;
+    return true;
+}
+
+// Attributes lat and lon of a trkpt tag from s (after the name) to e (at '>')
+static void pointattr(GpxParser *p, const char *s, const char *e)
+{
+    while (s < e) {
+        while (s < e && isspc(*s)) ++s;
+        const char *name = s;
+        while (s < e && *s != '=' && !isspc(*s)) ++s;
+        const char *nameend = s;
+        while (s < e && *s != '"' && *s != '\'') ++s;
+        if (s == e)
+            return;
+        const char quote = *s++;
+        const char *val = s;
+        const char *valend = memchr(s, quote, e - s);
+        if (!valend)
+            return;
+        s = valend + 1;
+        if (isname(name, nameend, "lat", 3))
+            parselat(val, valend, &p->lat);
+        else if (isname(name, nameend, "lon", 3))
+            parsee7(val, valend, &p->lon);
+    }
+}
+
+// Predefined XML entities
+static const struct {
+    const char *ent;
+    size_t len;
+    char c;
+} entity[] = {{"&amp;", 5, '&'}, {"&lt;", 4, '<'}, {"&gt;", 4, '>'}, {"&quot;", 6, '"'}, {"&apos;", 6, '\''}};
+
+// Name from s to e with entities decoded, truncated to NAMELEN - 1 bytes
+static void pointname(GpxParser *p, const char *s, const char *e)
+{
+    while (s < e && isspc(*s)) ++s;
+    while (e > s && isspc(e[-1])) --e;
+    size_t n = 0;
+    while (s < e && n < NAMELEN - 1) {
+        size_t i = 0;
+        if (*s == '&')
+            while (i < sizeof entity / sizeof *entity
+                && ((size_t)(e - s) < entity[i].len || memcmp(s, entity[i].ent, entity[i].len)))
+                ++i;
+        if (*s == '&' && i < sizeof entity / sizeof *entity) {
+            p->name[n++] = entity[i].c;
+            s += entity[i].len;
+        } else
+            p->name[n++] = *s++;
+    }
+    p->name[n] = '\0';
+    p->namelen = n;
+}
+
+// Where points of the current kind go, NULL = skip
+static void *pointdest(const GpxParser *p)
+{
+    switch (p->kind) {
+        case POINT_TRK: return p->trk;
+        case POINT_WPT: return p->wpt;
+        default: return p->rte;
+    }
+}
+
+static void endpoint(GpxParser *p)
+{
+    p->inpoint = false;
+    if (p->kind == POINT_TRK) {
+        p->points++;
+        if (p->trk && !trackpush(p->trk, p->lat, p->lon, p->ele, p->time))
+            p->oom = true;
+        return;
+    }
+    Waypoints *w = pointdest(p);
+    if (w && !wptpush(w, p->lat, p->lon, p->ele, p->time,
+            p->namelen == NONAME ? NULL : p->name, p->namelen))
+        p->oom = true;
+}
+
+void gpxinit(GpxParser *p, Track *t)
+{
+    *p = (GpxParser){.trk = t};
+}
+
+size_t gpxparse(GpxParser *p, const char *buf, const size_t len, const bool last)
+{
+    const char *s = buf, *end = buf + len;
+    while (s < end) {
+        const char *lt = memchr(s, '<', end - s);
+        if (p->text != TEXT_NONE) {
+            // Text content ends at the next tag
+            if (!lt && !last)
+                return s - buf;
+            const char *te = lt ? lt : end;
+            if (pointdest(p)) {
+                if (p->text == TEXT_ELE && !parsedecimal(s, te, &p->ele))
+                    p->ele = NAN;
+                else if (p->text == TEXT_TIME && !parseisotime(s, te, &p->time))
+                    p->time = NOTIME;
+                else if (p->text == TEXT_NAME)
+                    pointname(p, s, te);
+            }
+            p->text = TEXT_NONE;
+        }
+        if (!lt)
+            break;
+
+        // Comments, CDATA and declarations
+        const char *gt;
+        if (end - lt >= 4 && lt[1] == '!' && lt[2] == '-' && lt[3] == '-') {
+            if (!(gt = findend(lt + 4, end, "-->")))
+                goto incomplete;
+            s = gt + 3;
+            continue;
+        }
+        if (end - lt >= 9 && !memcmp(lt, "<![CDATA[", 9)) {
+            if (!(gt = findend(lt + 9, end, "]]>")))
+                goto incomplete;
+            s = gt + 3;
+            continue;
+        }
+        if (!(gt = memchr(lt, '>', end - lt)))
+            goto incomplete;
+        s = gt + 1;
+        if (lt[1] == '!' || lt[1] == '?')
+            continue;
+
+        // Element name
+        bool close = lt[1] == '/';
+        const char *name = lt + 1 + close;
+        const char *nameend = name;
+        while (nameend < gt && !isspc(*nameend) && *nameend != '/' && *nameend != '>')
+            ++nameend;
+        bool selfclose = gt[-1] == '/';
+
+        // Start of a point element, only outside points
+        int kind = POINT_RTE + 1;
+        if (!close && !p->inpoint)
+            for (kind = POINT_TRK; kind <= POINT_RTE; ++kind)
+                if (isname(name, nameend, pointtag[kind], pointtaglen[kind]))
+                    break;
+        if (close) {
+            if (p->inpoint && isname(name, nameend, pointtag[p->kind], pointtaglen[p->kind]))
+                endpoint(p);
+        } else if (kind <= POINT_RTE) {
+            p->inpoint = true;
+            p->kind = kind;
+            p->lat = p->lon = NOCOOR;
+            p->ele = NAN;
+            p->time = NOTIME;
+            p->namelen = NONAME;
+            if (pointdest(p))
+                pointattr(p, nameend, selfclose ? gt - 1 : gt);
+            if (selfclose)
+                endpoint(p);
+        } else if (isname(name, nameend, "rte", 3)) {
+            if (p->rte) {
+                tracknewtrk(&p->rte->pts);
+                if (!tracknewseg(&p->rte->pts))
+                    p->oom = true;
+            }
+        } else if (isname(name, nameend, "trkseg", 6)) {
+            if (p->trk && !tracknewseg(p->trk))
+                p->oom = true;
+        } else if (isname(name, nameend, "trk", 3)) {
+            if (p->trk)
+                tracknewtrk(p->trk);
+        } else if (p->inpoint && !selfclose) {
+            if (isname(name, nameend, "ele", 3))
+                p->text = TEXT_ELE;
+            else if (isname(name, nameend, "time", 4))
+                p->text = TEXT_TIME;
+            else if (p->kind != POINT_TRK && isname(name, nameend, "name", 4))
+                p->text = TEXT_NAME;
+        }
+        continue;
+    incomplete:
+        if (!last)
+            return lt - buf;
+        break;
+    }
+    return len;
+}
+
+// Byte range of a GPX buffer parsed by one thread
+typedef struct {
+    const char *buf;
+    size_t len;
+    bool last;     // end of the whole buffer
+    bool clean;    // ended between elements, so the next range started in the right state
+    GpxParser p;
+    Track trk;
+    Track *dest;   // stitching: copy trk to dest at offset
+    size_t offset;
+} Range;
+
+static void *parserange(void *arg)
+{
+    Range *r = arg;
+    // Segments count their trk elements from the one open at the start of the
+    // range, so seg.trk = trk elements opened before it in this range
+    r->trk.ntrk = 1;
+    gpxinit(&r->p, &r->trk);
+    size_t k = gpxparse(&r->p, r->buf, r->len, r->last);
+    r->clean = r->last || (k == r->len && !r->p.inpoint && r->p.text == TEXT_NONE);
+    return NULL;
+}
+
+static void *copyrange(void *arg)
+{
+    const Range *r = arg;
+    const Track *s = &r->trk;
+    Track *d = r->dest;
+    memcpy(d->lat + r->offset, s->lat, s->len * sizeof *s->lat);
+    memcpy(d->lon + r->offset, s->lon, s->len * sizeof *s->lon);
+    memcpy(d->ele + r->offset, s->ele, s->len * sizeof *s->ele);
+    memcpy(d->time + r->offset, s->time, s->len * sizeof *s->time);
+    return NULL;
+}
+
+// Segments of a range after the points before it. A range after the first
+// starts at a trkpt, so its own first segment only continues the last one.
+static bool mergesegments(const Range *r, const bool first, Track *t)
+{
+    const Track *s = &r->trk;
+    for (size_t i = !first && s->nseg && !s->seg[0].first; i < s->nseg; ++i) {
+        const size_t trk = t->ntrk + s->seg[i].trk;  // index + 1
+        if (!trackaddseg(t, r->offset + s->seg[i].first, trk ? trk - 1 : 0))
+            return false;
+    }
+    t->ntrk += s->ntrk - 1;
+    return true;
+}
+
+// Start of the first trkpt element at or after s
+static const char *nextpoint(const char *s, const char *end)
+{
+    while (s + 7 <= end && (s = memchr(s, '<', (size_t)(end - s - 6)))) {
+        if (!memcmp(s + 1, "trkpt", 5) && (isspc(s[6]) || s[6] == '>' || s[6] == '/'))
+            return s;
+        ++s;
+    }
+    return end;
+}
+
+bool gpxparsemt(const char *buf, const size_t len, const int nthreads, Track *t)
+{
+    int n = threadcount(nthreads);
+    if ((size_t)n > len / MINRANGE)
+        n = len / MINRANGE > 1 ? (int)(len / MINRANGE) : 1;
+    if (n == 1) {
+        GpxParser p;
+        gpxinit(&p, t);
+        gpxparse(&p, buf, len, true);
+        return !p.oom;
+    }
+    Range *range = calloc((size_t)n, sizeof *range);
+    if (!range)
+        return false;
+
+    // Every range after the first starts at a trkpt tag, found by scanning
+    // from an equal split. That is a guess: the tag could be in a comment or
+    // CDATA section. It is checked afterwards.
+    const char *end = buf + len, *start = buf;
+    for (int i = 0; i < n; ++i) {
+        const char *next = i + 1 < n ? nextpoint(buf + partstart(len, i + 1, n), end) : end;
+        if (next < start)
+            next = start;
+        range[i] = (Range){.buf = start, .len = (size_t)(next - start), .last = i + 1 == n};
+        start = next;
+    }
+    parallel(n, parserange, range, sizeof *range);
+
+    // Speculation holds if every range ended outside any element, comment or point
+    bool clean = true, oom = false;
+    size_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        clean &= range[i].clean;
+        oom |= range[i].p.oom;
+        range[i].dest = t;
+        range[i].offset = t->len + total;
+        total += range[i].trk.len;
+    }
+    bool ok = !oom;
+    if (ok && clean) {
+        if ((ok = trackreserve(t, t->len + total))) {
+            for (int i = 0; i < n && ok; ++i)
+                ok = mergesegments(&range[i], !i, t);
+            parallel(n, copyrange, range, sizeof *range);
+            t->len += total;
+        }
+    } else if (ok) {
+        GpxParser p;
+        gpxinit(&p, t);
+        gpxparse(&p, buf, len, true);
+        ok = !p.oom;
+    }
+    for (int i = 0; i < n; ++i)
+        trackfree(&range[i].trk);
+    free(range);
+    return ok;
+}
+
+char *readfile(const char *fname, size_t *size)
+{
+    FILE *f = fopen(fname, "rb");
+    if (!f)
+        return NULL;
+    char *buf = NULL;
+    if (!fseek(f, 0, SEEK_END)) {
+        long n = ftell(f);
+        if (n >= 0 && !fseek(f, 0, SEEK_SET) && (buf = malloc((size_t)n + 1))) {
+            *size = fread(buf, 1, (size_t)n, f);
+            buf[*size] = '\0';
+            if (*size != (size_t)n) {
+                free(buf);
+                buf = NULL;
+            }
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+static size_t parsechunk(void *p, const char *buf, const size_t len, const bool last)
+{
+    return gpxparse(p, buf, len, last);
+}
+
+bool gpxstream(GpxParser *p, const char *fname)
+{
+    return streaminput(fname, parsechunk, p);
+}
+
+bool gpxread(const char *fname, Track *t)
+{
+    GpxParser p;
+    gpxinit(&p, t);
+    return gpxstream(&p, fname) && !p.oom;
+}
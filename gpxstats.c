@@ -0,0 +1,188 @@
+/*****************************************************************************
+ * GPX STATS
+ * Length, climbing and grades of GPX files, one line per file and the
+ * total over all files:
+ *
+ *     gpxstats [-m method] [-t tolerance] [-d demdir] [-e filter[:param]]
+ *              [-H hysteresis] [-g gradedist] [-j threads] [-h] file...
+ *
+ * Distances with the chosen method (default adaptive, see greatcircledist)
+ * within trkseg elements. With -d the elevations are those of the SRTM .hgt
+ * tiles in demdir (see dem.h) where it has data. With -e the elevations are
+ * smoothed first with sg, median or kalman (see smooth.h), e.g. -e sg:7 or
+ * -e median. Ascent and descent count elevation changes of at least the
+ * hysteresis (default 5 m), raw ascent and descent every change from point
+ * to point. Grades are from elevations at least gradedist apart (default
+ * 100 m); -h also prints the histogram of the total in km per percent grade.
+ *
+ * Every file is read and summarised in one pass by one of the worker threads
+ * (default: all processors), which take the next file when done; every
+ * thread reuses its own arena for the track, so after the largest file no
+ * more memory is allocated.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>     // printf, fprintf
+#include <stdlib.h>    // malloc, calloc, free, exit, strtod, strtol
+#include <string.h>    // strcmp
+#include <stdatomic.h> // atomic_fetch_add
+#include <unistd.h>    // getopt
+#include "gpxio.h"
+#include "arena.h"
+#include "parallel.h"
+#include "stats.h"
+#include "smooth.h"
+#include "dem.h"
+
+typedef struct {
+    char **fname;
+    size_t nfiles;
+    Method method;
+    double tol;
+    StatsParams par;
+    Smoother smooth;
+    const char *demdir;  // NULL = elevations from the files
+    Summary *sum;      // per file
+    bool *ok;          // per file: read without error
+    atomic_size_t next;  // next file to do
+} Job;
+
+typedef struct {
+    Job *job;
+    Arena arena;
+    Smoother smooth;   // copy of the job's, with its own state
+    Dem dem;           // own tile cache
+} Worker;
+
+static void fail(const char *msg)
+{
+    fprintf(stderr, "%s\n", msg);
+    exit(EXIT_FAILURE);
+}
+
+static void *work(void *arg)
+{
+    Worker *w = arg;
+    Job *job = w->job;
+    for (size_t i; (i = atomic_fetch_add(&job->next, 1)) < job->nfiles; ) {
+        arenareset(&w->arena);
+        Track t = {.arena = &w->arena};
+        summaryinit(&job->sum[i]);
+        job->ok[i] = gpxread(job->fname[i], &t);
+        if (job->ok[i]) {
+            job->sum[i].files = 1;
+            if (job->demdir)
+                demtrack(&w->dem, &t, 0, t.len);
+            tracksmooth(&t, &w->smooth);
+            tracksummary(&t, job->method, job->tol, &job->par, &job->sum[i]);
+        }
+    }
+    return NULL;
+}
+
+static void printsummary(const Summary *s, const char *name)
+{
+    const int64_t sec = s->duration / 1000;
+    printf("%10.3f %8.1f %8.1f %8.1f %8.1f %7.1f %7.1f %6.1f %6.1f %3d:%02d:%02d %s\n",
+        s->length / 1000, s->ascent, s->descent, s->rawascent, s->rawdescent,
+        s->minele, s->maxele, s->mingrade, s->maxgrade,
+        (int)(sec / 3600), (int)(sec / 60 % 60), (int)(sec % 60), name);
+}
+
+int main(int argc, char *argv[])
+{
+    Job job = {.method = ADAPTIVE, .tol = TOLERANCE, .par = {HYSTERESIS, GRADEDIST}};
+    int nthreads = 0;
+    bool histogram = false;
+    int opt;
+    char *end;
+    while ((opt = getopt(argc, argv, "m:t:d:e:H:g:j:h")) != -1) {
+        switch (opt) {
+            case 'm':
+                for (job.method = 0; job.method < METHODS && strcmp(optarg, methodname[job.method]); ++job.method)
+                    ;
+                if (job.method == METHODS)
+                    fail("Unknown method.");
+                break;
+            case 't':
+                job.tol = strtod(optarg, &end);
+                if (*end || !(job.tol > 0))
+                    fail("Tolerance must be a positive number of metres.");
+                break;
+            case 'd': job.demdir = optarg; break;
+            case 'e':
+                if (!smoothparse(&job.smooth, optarg))
+                    fail("Unknown filter or parameter out of range.");
+                break;
+            case 'H':
+                job.par.hysteresis = strtod(optarg, &end);
+                if (*end || !(job.par.hysteresis >= 0))
+                    fail("Hysteresis must be a number of metres, 0 or more.");
+                break;
+            case 'g':
+                job.par.gradedist = strtod(optarg, &end);
+                if (*end || !(job.par.gradedist > 0))
+                    fail("Grade distance must be a positive number of metres.");
+                break;
+            case 'j':
+                nthreads = (int)strtol(optarg, &end, 10);
+                if (*end || nthreads < 0)
+                    fail("Threads must be a number, 0 = all processors.");
+                break;
+            case 'h': histogram = true; break;
+            default:
+                fail("Usage: gpxstats [-m method] [-t tolerance] [-d demdir] [-e filter[:param]]\n"
+                     "                [-H hysteresis] [-g gradedist] [-j threads] [-h] file...");
+        }
+    }
+    if (optind == argc)
+        fail("No files.");
+    job.fname = argv + optind;
+    job.nfiles = (size_t)(argc - optind);
+    job.sum = malloc(job.nfiles * sizeof *job.sum);
+    job.ok = malloc(job.nfiles * sizeof *job.ok);
+    nthreads = threadcount(nthreads);
+    if ((size_t)nthreads > job.nfiles)
+        nthreads = (int)job.nfiles;
+    Worker *worker = calloc((size_t)nthreads, sizeof *worker);
+    if (!job.sum || !job.ok || !worker)
+        fail("Out of memory.");
+    for (int i = 0; i < nthreads; ++i) {
+        worker[i] = (Worker){.job = &job, .smooth = job.smooth};
+        if (job.demdir && !demopen(&worker[i].dem, job.demdir))
+            fail("Out of memory.");
+    }
+    parallel(nthreads, work, worker, sizeof *worker);
+
+    printf("%10s %8s %8s %8s %8s %7s %7s %6s %6s %9s %s\n",
+        "km", "ascent", "descent", "rawasc", "rawdesc", "minele", "maxele", "mingr", "maxgr", "duration", "file");
+    Summary total;
+    summaryinit(&total);
+    int status = EXIT_SUCCESS;
+    for (size_t i = 0; i < job.nfiles; ++i) {
+        if (!job.ok[i]) {
+            fprintf(stderr, "Could not read %s.\n", job.fname[i]);
+            status = EXIT_FAILURE;
+            continue;
+        }
+        printsummary(&job.sum[i], job.fname[i]);
+        summaryadd(&total, &job.sum[i]);
+    }
+    if (job.nfiles > 1)
+        printsummary(&total, "total");
+    if (histogram)
+        for (int i = 0; i < GRADEBINS; ++i)
+            printf("%s%3d%% %10.3f\n", i == 0 ? "<=" : i == GRADEBINS - 1 ? ">=" : "  ",
+                i - GRADEMAX, total.grade[i] / 1000);
+
+    for (int i = 0; i < nthreads; ++i) {
+        arenafree(&worker[i].arena);
+        demclose(&worker[i].dem);
+    }
+    free(worker);
+    free(job.sum);
+    free(job.ok);
+    return fflush(stdout) ? EXIT_FAILURE : status;
+}
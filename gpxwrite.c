@@ -0,0 +1,231 @@
+/*****************************************************************************
+ * GPX WRITER
+ * See gpxio.h. Numbers are formatted as fixed point integers without printf:
+ * coordinates with 7 decimals straight from the track store and elevation
+ * with 3, trailing zeros removed, so coordinates read from a GPX file are
+ * written back unchanged. Segment boundaries of the track become trkseg and
+ * trk elements.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdio.h>    // fopen, fwrite, fclose
+#include <stdlib.h>   // realloc, free
+#include <string.h>   // memcpy, strlen
+#include <math.h>     // isnan, llround
+#include "gpxio.h"
+
+#define MAXPOINTLEN 256  // more than the longest formatted trkpt element
+#define MINTIME (-62167219200000LL)  // 0000-01-01T00:00:00Z, first time with a four digit year
+#define MAXTIME 253402300799999LL    // 9999-12-31T23:59:59.999Z, last time with a four digit year
+
+static const char *header =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<gpx version=\"1.1\" creator=\"https://github.com/ednl/gpx\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+    "  <trk>\n"
+    "    <trkseg>\n";
+static const char *newseg =
+    "    </trkseg>\n"
+    "    <trkseg>\n";
+static const char *newtrk =
+    "    </trkseg>\n"
+    "  </trk>\n"
+    "  <trk>\n"
+    "    <trkseg>\n";
+static const char *footer =
+    "    </trkseg>\n"
+    "  </trk>\n"
+    "</gpx>\n";
+
+bool bufreserve(TextBuffer *out, const size_t n)
+{
+    if (out->len + n <= out->cap)
+        return true;
+    size_t cap = out->cap ? out->cap : 4096;
+    while (cap < out->len + n)
+        cap *= 2;
+    char *buf = realloc(out->buf, cap);
+    if (!buf)
+        return false;
+    out->buf = buf;
+    out->cap = cap;
+    return true;
+}
+
+static char *putstr(char *p, const char *s)
+{
+    size_t n = strlen(s);
+    memcpy(p, s, n);
+    return p + n;
+}
+
+// Unsigned integer with at least mindigits digits (zero-padded)
+static char *putuint(char *p, uint64_t x, const int mindigits)
+{
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x || n < mindigits);
+    while (n)
+        *p++ = tmp[--n];
+    return p;
+}
+
+static const int64_t scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+// Fixed point integer v with 'decimals' decimals, no trailing zeros
+static char *putscaled(char *p, int64_t v, int decimals)
+{
+    if (v < 0) {
+        *p++ = '-';
+        v = -v;
+    }
+    uint64_t ipart = (uint64_t)v / (uint64_t)scale[decimals];
+    uint64_t fpart = (uint64_t)v % (uint64_t)scale[decimals];
+    p = putuint(p, ipart, 1);
+    if (fpart) {
+        while (fpart % 10 == 0) {
+            fpart /= 10;
+            --decimals;
+        }
+        *p++ = '.';
+        p = putuint(p, fpart, decimals);
+    }
+    return p;
+}
+
+// Number with at most 'decimals' decimals, no trailing zeros
+static char *putfixed(char *p, const double x, const int decimals)
+{
+    return putscaled(p, llround(x * scale[decimals]), decimals);
+}
+
+// Civil date from days since 1970-01-01
+// Ref.: https://howardhinnant.github.io/date_algorithms.html#civil_from_days
+static void civilfromdays(int64_t z, int *y, int *m, int *d)
+{
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const int doe = (int)(z - era * 146097);
+    const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = (int)(yoe + era * 400) + (*m <= 2);
+}
+
+// ISO-8601 UTC timestamp, milliseconds only if not zero
+static char *puttime(char *p, const int64_t ms)
+{
+    int64_t sec = ms >= 0 ? ms / 1000 : (ms - 999) / 1000;
+    int frac = (int)(ms - sec * 1000);
+    int64_t days = sec >= 0 ? sec / 86400 : (sec - 86399) / 86400;
+    int daysec = (int)(sec - days * 86400);
+    int y, m, d;
+    civilfromdays(days, &y, &m, &d);
+    p = putuint(p, (uint64_t)y, 4); *p++ = '-';
+    p = putuint(p, (uint64_t)m, 2); *p++ = '-';
+    p = putuint(p, (uint64_t)d, 2); *p++ = 'T';
+    p = putuint(p, (uint64_t)(daysec / 3600), 2); *p++ = ':';
+    p = putuint(p, (uint64_t)(daysec / 60 % 60), 2); *p++ = ':';
+    p = putuint(p, (uint64_t)(daysec % 60), 2);
+    if (frac) {
+        *p++ = '.';
+        p = putuint(p, (uint64_t)frac, 3);
+    }
+    *p++ = 'Z';
+    return p;
+}
+
+static bool append(TextBuffer *out, const char *s)
+{
+    if (!bufreserve(out, strlen(s)))
+        return false;
+    out->len = (size_t)(putstr(out->buf + out->len, s) - out->buf);
+    return true;
+}
+
+bool gpxformathead(TextBuffer *out)
+{
+    return append(out, header);
+}
+
+bool gpxformatfoot(TextBuffer *out)
+{
+    return append(out, footer);
+}
+
+static bool formatrange(const Track *t, const size_t first, const size_t last, TextBuffer *out)
+{
+    for (size_t i = first; i < last; ++i) {
+        // lat and lon are required in GPX: leave out a point without them
+        if (t->lat[i] == NOCOOR || t->lon[i] == NOCOOR)
+            continue;
+        if (!bufreserve(out, MAXPOINTLEN))
+            return false;
+        char *p = out->buf + out->len;
+        p = putstr(p, "      <trkpt lat=\"");
+        p = putscaled(p, t->lat[i], 7);
+        p = putstr(p, "\" lon=\"");
+        p = putscaled(p, t->lon[i], 7);
+        p = putstr(p, "\">\n");
+        if (!isnan(t->ele[i])) {
+            p = putstr(p, "        <ele>");
+            p = putfixed(p, t->ele[i], 3);
+            p = putstr(p, "</ele>\n");
+        }
+        // Out of range as missing: more or fewer year digits would not read back
+        if (t->time[i] >= MINTIME && t->time[i] <= MAXTIME) {
+            p = putstr(p, "        <time>");
+            p = puttime(p, t->time[i]);
+            p = putstr(p, "</time>\n");
+        }
+        p = putstr(p, "      </trkpt>\n");
+        out->len = (size_t)(p - out->buf);
+    }
+    return true;
+}
+
+bool gpxformatpoints(const Track *t, const size_t first, const size_t n, TextBuffer *out)
+{
+    // Points up to each segment start after point 0, then the boundary
+    const size_t last = first + n;
+    size_t k = 0;
+    while (k < t->nseg && (t->seg[k].first < first || !t->seg[k].first))
+        ++k;
+    for (size_t i = first; i < last; ++k) {
+        const size_t stop = k < t->nseg && t->seg[k].first < last ? t->seg[k].first : last;
+        if (!formatrange(t, i, stop, out))
+            return false;
+        if (stop < last && !append(out, t->seg[k].trk != t->seg[k - 1].trk ? newtrk : newseg))
+            return false;
+        i = stop;
+    }
+    return true;
+}
+
+bool gpxformat(const Track *t, TextBuffer *out)
+{
+    return gpxformathead(out) && gpxformatpoints(t, 0, t->len, out) && gpxformatfoot(out);
+}
+
+bool writefile(const char *fname, const char *buf, const size_t len)
+{
+    FILE *f = fopen(fname, "wb");
+    bool ok = f && fwrite(buf, 1, len, f) == len;
+    if (f && fclose(f))
+        ok = false;
+    return ok;
+}
+
+bool gpxwrite(const char *fname, const Track *t)
+{
+    TextBuffer out = {0};
+    bool ok = gpxformat(t, &out) && writefile(fname, out.buf, out.len);
+    free(out.buf);
+    return ok;
+}
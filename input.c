@@ -0,0 +1,458 @@
+/*****************************************************************************
+ * INPUT FILES
+ * See input.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>    // aligned_alloc, malloc, realloc, free
+#include <string.h>    // strcmp, memcpy, memmove
+#include <errno.h>     // errno, EINTR
+#include <fcntl.h>     // open
+#include <unistd.h>    // read, close
+#include <pthread.h>   // pthread_create, pthread_join, pthread_mutex_*, pthread_cond_*
+#include <sys/mman.h>  // mmap, munmap, madvise
+#include <sys/stat.h>  // fstat
+#include <zlib.h>      // inflate
+#ifdef HAVE_ZSTD
+#include <zstd.h>      // ZSTD_decompressStream
+#endif
+#include "input.h"
+
+#define HUGEPAGE ((size_t)2 << 20)   // alignment of the read buffer for transparent huge pages
+#define INBUF    ((size_t)1 << 20)   // compressed bytes per read()
+#define SLOTS    4                   // decompressed chunks in flight
+#define HEADROOM ((size_t)64 << 10)  // room before a decompressed chunk for the unconsumed rest of the previous one
+
+enum { PLAIN, GZIP, ZSTD };
+
+// Decompressed chunk
+typedef struct {
+    char *buf;  // HEADROOM + INPUTCHUNK bytes, data starts at buf + HEADROOM
+    size_t len;
+    bool last;
+} Slot;
+
+// Decompression thread and the queue of chunks it fills
+typedef struct {
+    int kind;
+    const unsigned char *pre;  // compressed bytes already in memory: mapped file or first chunk read
+    size_t prelen;
+    int fd;                    // rest of the compressed input, -1 if none
+    Slot slot[SLOTS];
+    size_t head, tail, count;  // producer fills slot[head], consumer reads from slot[tail]
+    bool error, stop;
+    pthread_mutex_t lock;
+    pthread_cond_t notfull, notempty;
+} Decompressor;
+
+int openinput(const char *fname)
+{
+    return strcmp(fname, "-") ? open(fname, O_RDONLY) : dup(STDIN_FILENO);
+}
+
+// Map a regular file with read-ahead hints, NULL if not possible
+static char *mapfd(const int fd, size_t *size)
+{
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return NULL;
+    char *buf = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buf == MAP_FAILED)
+        return NULL;
+#ifdef MADV_SEQUENTIAL
+    madvise(buf, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+    madvise(buf, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+#ifdef MADV_HUGEPAGE
+    madvise(buf, (size_t)st.st_size, MADV_HUGEPAGE);  // only if the kernel supports it for files
+#endif
+    *size = (size_t)st.st_size;
+    return buf;
+}
+
+// Read until buf[0..cap) is full or end of file; bytes read or -1 on error
+static ptrdiff_t readfull(const int fd, char *buf, const size_t cap)
+{
+    size_t n = 0;
+    while (n < cap) {
+        ssize_t r = read(fd, buf + n, cap - n);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return -1;
+        if (!r)
+            break;
+        n += (size_t)r;
+    }
+    return (ptrdiff_t)n;
+}
+
+// Large read buffer on a huge page boundary
+static char *chunkbuffer(const size_t size)
+{
+    char *buf = aligned_alloc(HUGEPAGE, size);
+#ifdef MADV_HUGEPAGE
+    if (buf)
+        madvise(buf, size, MADV_HUGEPAGE);
+#endif
+    return buf;
+}
+
+// Compression from the magic number at the start of the input
+static int compression(const char *buf, const size_t len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    if (len >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+        return GZIP;
+    if (len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+        return ZSTD;
+    return PLAIN;
+}
+
+// Next free slot for the producer, NULL if the consumer stopped
+static Slot *claim(Decompressor *d)
+{
+    pthread_mutex_lock(&d->lock);
+    while (d->count == SLOTS && !d->stop)
+        pthread_cond_wait(&d->notfull, &d->lock);
+    Slot *s = d->stop ? NULL : &d->slot[d->head];
+    pthread_mutex_unlock(&d->lock);
+    if (s)
+        *s = (Slot){.buf = s->buf};
+    return s;
+}
+
+static void publish(Decompressor *d, const bool last, const bool error)
+{
+    pthread_mutex_lock(&d->lock);
+    d->slot[d->head].last = last;
+    d->error |= error;
+    d->head = (d->head + 1) % SLOTS;
+    d->count++;
+    pthread_cond_signal(&d->notempty);
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Next piece of compressed input; bytes or 0 at the end, -1 on error
+static ptrdiff_t nextinput(Decompressor *d, unsigned char *inbuf, const unsigned char **in)
+{
+    if (d->prelen) {
+        const ptrdiff_t n = (ptrdiff_t)d->prelen;
+        *in = d->pre;
+        d->prelen = 0;
+        return n;
+    }
+    if (d->fd == -1)
+        return 0;
+    *in = inbuf;
+    return readfull(d->fd, (char *)inbuf, INBUF);
+}
+
+// Decompression thread for gzip, also zlib streams and concatenated gzip members
+static void *gunzip(void *arg)
+{
+    Decompressor *d = arg;
+    unsigned char *inbuf = d->fd != -1 ? malloc(INBUF) : NULL;
+    z_stream z = {0};
+    bool ok = (d->fd == -1 || inbuf) && inflateInit2(&z, 15 + 32) == Z_OK;
+    bool done = false;  // at the end of a gzip member
+    Slot *s = claim(d);  // also to report a failed setup
+    while (s && ok) {
+        if (!z.avail_in) {
+            const unsigned char *in;
+            const ptrdiff_t n = nextinput(d, inbuf, &in);
+            if (n <= 0) {
+                ok = !n && done;  // truncated if not at the end of a member
+                break;
+            }
+            z.next_in = (unsigned char *)in;
+            z.avail_in = (uInt)n;
+        }
+        if (done) {
+            inflateReset(&z);
+            done = false;
+        }
+        z.next_out = (unsigned char *)s->buf + HEADROOM + s->len;
+        z.avail_out = (uInt)(INPUTCHUNK - s->len);
+        const int ret = inflate(&z, Z_NO_FLUSH);
+        s->len = INPUTCHUNK - z.avail_out;
+        if (ret == Z_STREAM_END)
+            done = true;
+        else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            ok = false;
+            break;
+        }
+        if (s->len == INPUTCHUNK) {
+            publish(d, false, false);
+            s = claim(d);
+        }
+    }
+    if (s)
+        publish(d, true, !ok);
+    inflateEnd(&z);
+    free(inbuf);
+    return NULL;
+}
+
+#ifdef HAVE_ZSTD
+// Decompression thread for zstd, also concatenated frames
+static void *unzstd(void *arg)
+{
+    Decompressor *d = arg;
+    unsigned char *inbuf = d->fd != -1 ? malloc(INBUF) : NULL;
+    ZSTD_DStream *zs = ZSTD_createDStream();
+    bool ok = (d->fd == -1 || inbuf) && zs && !ZSTD_isError(ZSTD_initDStream(zs));
+    size_t hint = 0;  // 0 = at the end of a frame
+    ZSTD_inBuffer in = {0};
+    Slot *s = claim(d);  // also to report a failed setup
+    while (s && ok) {
+        if (in.pos == in.size) {
+            const unsigned char *src;
+            const ptrdiff_t n = nextinput(d, inbuf, &src);
+            if (n <= 0) {
+                ok = !n && !hint;
+                break;
+            }
+            in = (ZSTD_inBuffer){src, (size_t)n, 0};
+        }
+        ZSTD_outBuffer out = {s->buf + HEADROOM, INPUTCHUNK, s->len};
+        hint = ZSTD_decompressStream(zs, &out, &in);
+        s->len = out.pos;
+        if (ZSTD_isError(hint)) {
+            ok = false;
+            break;
+        }
+        if (s->len == INPUTCHUNK) {
+            publish(d, false, false);
+            s = claim(d);
+        }
+    }
+    if (s)
+        publish(d, true, !ok);
+    ZSTD_freeDStream(zs);
+    free(inbuf);
+    return NULL;
+}
+#endif
+
+// Decompress on a separate thread and pass the chunks to the consumer
+static bool decompress(const int kind, const char *pre, const size_t prelen, const int fd,
+    ChunkFunc consume, void *ctx)
+{
+#ifdef HAVE_ZSTD
+    void *(*func)(void *) = kind == GZIP ? gunzip : unzstd;
+#else
+    if (kind != GZIP)
+        return false;  // zstd support not compiled in
+    void *(*func)(void *) = gunzip;
+#endif
+    Decompressor d = {.kind = kind, .pre = (const unsigned char *)pre, .prelen = prelen, .fd = fd};
+    bool ok = true;
+    for (int i = 0; i < SLOTS && ok; ++i)
+        ok = (d.slot[i].buf = malloc(HEADROOM + INPUTCHUNK)) != NULL;
+    pthread_t thread;
+    pthread_mutex_init(&d.lock, NULL);
+    pthread_cond_init(&d.notfull, NULL);
+    pthread_cond_init(&d.notempty, NULL);
+    if (ok && pthread_create(&thread, NULL, func, &d))
+        ok = false;
+
+    // The unconsumed rest of a chunk goes in front of the next chunk, in
+    // its headroom if it fits, else both are joined in the carry buffer
+    char *carry = NULL;
+    size_t keep = 0, carrycap = 0;
+    const char *rest = NULL;
+    bool held = false;  // slot[tail] still holds the rest
+    bool started = ok;
+    while (ok) {
+        pthread_mutex_lock(&d.lock);
+        while (d.count <= (size_t)held)
+            pthread_cond_wait(&d.notempty, &d.lock);
+        Slot *s = &d.slot[(d.tail + held) % SLOTS];
+        ok = !d.error;
+        pthread_mutex_unlock(&d.lock);
+        if (!ok)
+            break;
+        char *data = s->buf + HEADROOM;
+        if (keep <= HEADROOM) {
+            if (keep)
+                memmove(data - keep, rest, keep);
+            data -= keep;
+        } else {
+            if (keep + s->len > carrycap) {
+                carrycap = 2 * (keep + s->len);
+                char *tmp = malloc(carrycap);
+                if (!(ok = tmp != NULL))
+                    break;
+                memcpy(tmp, rest, keep);
+                free(carry);
+                carry = tmp;
+            } else
+                memmove(carry, rest, keep);
+            memcpy(carry + keep, s->buf + HEADROOM, s->len);
+            data = carry;
+        }
+        const size_t len = keep + s->len;
+        const bool last = s->last;
+        const size_t used = consume(ctx, data, len, last);
+        pthread_mutex_lock(&d.lock);
+        if (held) {
+            d.tail = (d.tail + 1) % SLOTS;
+            d.count--;
+            pthread_cond_signal(&d.notfull);
+        }
+        pthread_mutex_unlock(&d.lock);
+        held = true;
+        keep = len - used;
+        rest = data + used;
+        if (last)
+            break;
+    }
+
+    if (started) {
+        pthread_mutex_lock(&d.lock);
+        d.stop = true;
+        pthread_cond_signal(&d.notfull);
+        pthread_mutex_unlock(&d.lock);
+        pthread_join(thread, NULL);
+    }
+    pthread_mutex_destroy(&d.lock);
+    pthread_cond_destroy(&d.notfull);
+    pthread_cond_destroy(&d.notempty);
+    for (int i = 0; i < SLOTS; ++i)
+        free(d.slot[i].buf);
+    free(carry);
+    return ok;
+}
+
+// Stream an open file through the consumer and close it
+static bool streamfd(const int fd, ChunkFunc consume, void *ctx)
+{
+    size_t size;
+    char *buf = mapfd(fd, &size);
+    if (buf) {
+        close(fd);
+        const int kind = compression(buf, size);
+        bool ok = true;
+        if (kind == PLAIN)
+            consume(ctx, buf, size, true);
+        else
+            ok = decompress(kind, buf, size, -1, consume, ctx);
+        munmap(buf, size);
+        return ok;
+    }
+    // Chunks with the unconsumed rest of the previous chunk at the front
+    size_t cap = INPUTCHUNK, keep = 0;
+    bool ok = (buf = chunkbuffer(cap)) != NULL, first = true;
+    while (ok) {
+        ptrdiff_t n = readfull(fd, buf + keep, cap - keep);
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        const size_t len = keep + (size_t)n;
+        if (first) {
+            first = false;
+            const int kind = compression(buf, len);
+            if (kind != PLAIN) {
+                ok = decompress(kind, buf, len, len < cap ? -1 : fd, consume, ctx);
+                break;
+            }
+        }
+        const bool last = len < cap;
+        const size_t used = consume(ctx, buf, len, last);
+        if (last)
+            break;
+        keep = len - used;
+        if (keep == cap) {
+            // One token larger than the buffer
+            char *tmp = chunkbuffer(cap * 2);
+            if (!(ok = tmp != NULL))
+                break;
+            memcpy(tmp, buf, keep);
+            free(buf);
+            buf = tmp;
+            cap *= 2;
+        } else
+            memmove(buf, buf + used, keep);
+    }
+    free(buf);
+    close(fd);
+    return ok;
+}
+
+bool streaminput(const char *fname, ChunkFunc consume, void *ctx)
+{
+    const int fd = openinput(fname);
+    return fd != -1 && streamfd(fd, consume, ctx);
+}
+
+// Consumer that collects everything in a growing buffer
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    bool oom;
+} Collector;
+
+static size_t collect(void *ctx, const char *buf, const size_t len, const bool last)
+{
+    (void)last;
+    Collector *c = ctx;
+    if (c->oom)
+        return len;
+    if (c->len + len > c->cap) {
+        size_t cap = c->cap ? c->cap : INPUTCHUNK;
+        while (cap < c->len + len)
+            cap *= 2;
+        char *tmp = realloc(c->buf, cap);
+        if (!tmp) {
+            c->oom = true;
+            return len;
+        }
+        c->buf = tmp;
+        c->cap = cap;
+    }
+    memcpy(c->buf + c->len, buf, len);
+    c->len += len;
+    return len;
+}
+
+bool loadinput(Input *in, const char *fname)
+{
+    *in = (Input){0};
+    const int fd = openinput(fname);
+    if (fd == -1)
+        return false;
+    size_t size;
+    char *buf = mapfd(fd, &size);
+    if (buf && compression(buf, size) == PLAIN) {
+        close(fd);
+        *in = (Input){.buf = buf, .size = size, .mapped = true};
+        return true;
+    }
+    if (buf) {
+        munmap(buf, size);
+        lseek(fd, 0, SEEK_SET);
+    }
+    // Not mappable or compressed: collect the stream
+    Collector c = {0};
+    if (!streamfd(fd, collect, &c) || c.oom) {
+        free(c.buf);
+        return false;
+    }
+    *in = (Input){.buf = c.buf, .size = c.len};
+    return true;
+}
+
+void freeinput(Input *in)
+{
+    if (in->mapped)
+        munmap((void *)in->buf, in->size);
+    else
+        free((void *)in->buf);
+    *in = (Input){0};
+}
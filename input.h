@@ -0,0 +1,48 @@
+/*****************************************************************************
+ * INPUT FILES
+ * Regular files are memory mapped with sequential read-ahead hints, so the
+ * tokenizer reads straight from the page cache without a copy. Pipes, stdin
+ * and other files that cannot be mapped are read with large read() calls
+ * into an aligned buffer, either in chunks for the incremental parsers or
+ * completely for formats that need the whole input. File name "-" is stdin.
+ * Gzip and zstd (if compiled with HAVE_ZSTD) input is recognised by its
+ * magic number and decompressed on a separate thread, a few chunks ahead of
+ * the consumer.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#define INPUTCHUNK ((size_t)4 << 20)  // bytes per read() for unmappable input
+
+// Whole input in memory
+typedef struct {
+    const char *buf;
+    size_t size;
+    bool mapped;  // munmap instead of free
+} Input;
+
+// Consumer of chunks: returns the number of bytes used from buf[0..len); the
+// rest is passed again at the start of the next chunk. last = end of input.
+typedef size_t (*ChunkFunc)(void *ctx, const char *buf, const size_t len, const bool last);
+
+// Open a file for reading, "-" = stdin; -1 on error
+int openinput(const char *fname);
+
+// Map or read the whole input, false on error
+bool loadinput(Input *in, const char *fname);
+
+// Release the input
+void freeinput(Input *in);
+
+// Stream a file from start to end through the consumer: mapped in one piece
+// if possible, else in chunks of INPUTCHUNK bytes; false on error
+bool streaminput(const char *fname, ChunkFunc consume, void *ctx);
+
+#endif
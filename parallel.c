@@ -0,0 +1,206 @@
+/*****************************************************************************
+ * PARALLEL
+ * See parallel.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // malloc, free
+#include <unistd.h>   // sysconf
+#include <pthread.h>  // pthread_create, pthread_join
+#include "parallel.h"
+
+#define MINSCAN 65536  // elements per thread worth starting a thread for in prefixsum()
+#define LANES   4      // independent sums in the reduction, for SIMD
+
+int cpucount(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : (n > MAXTHREADS ? MAXTHREADS : (int)n);
+}
+
+int threadcount(const int n)
+{
+    return n <= 0 ? cpucount() : (n > MAXTHREADS ? MAXTHREADS : n);
+}
+
+void parallel(const int n, void *(*func)(void *), void *arg, const size_t size)
+{
+    pthread_t thread[MAXTHREADS];
+    bool started[MAXTHREADS] = {0};
+    for (int i = 1; i < n; ++i)
+        started[i] = !pthread_create(&thread[i], NULL, func, (char *)arg + i * size);
+    func(arg);
+    for (int i = 1; i < n; ++i)
+        if (started[i])
+            pthread_join(thread[i], NULL);
+        else
+            func((char *)arg + i * size);
+}
+
+typedef struct {
+    const double *x;
+    double *sum;
+    size_t first, last;
+    KahanSum total;  // pass 1: total of this part; pass 2: total of all parts before it
+} ScanPart;
+
+// Pass 1: total of a part, in LANES interleaved sums that the compiler can vectorise
+static void *reducepart(void *arg)
+{
+    ScanPart *p = arg;
+    KahanSum lane[LANES] = {0};
+    size_t i = p->first;
+    for (; i + LANES <= p->last; i += LANES)
+        for (int j = 0; j < LANES; ++j)
+            kahanadd(&lane[j], p->x[i + j]);
+    for (; i < p->last; ++i)
+        kahanadd(&lane[0], p->x[i]);
+    KahanSum total = {0};
+    for (int j = 0; j < LANES; ++j) {
+        kahanadd(&total, lane[j].s);
+        kahanadd(&total, lane[j].c);
+    }
+    p->total = total;
+    return NULL;
+}
+
+// Pass 2: running sum of a part, starting from the total before it
+static void *scanpart(void *arg)
+{
+    const ScanPart *p = arg;
+    KahanSum acc = p->total;
+    for (size_t i = p->first; i < p->last; ++i) {
+        kahanadd(&acc, p->x[i]);
+        p->sum[i] = kahantotal(acc);
+    }
+    return NULL;
+}
+
+void prefixsum(const double *x, const size_t n, double *sum, const int nthreads)
+{
+    int parts = threadcount(nthreads);
+    if ((size_t)parts > n / MINSCAN)
+        parts = n / MINSCAN > 1 ? (int)(n / MINSCAN) : 1;
+    ScanPart part[MAXTHREADS];
+    for (int i = 0; i < parts; ++i)
+        part[i] = (ScanPart){x, sum, partstart(n, i, parts), partstart(n, i + 1, parts), {0, 0}};
+    if (parts > 1) {
+        // Reduce, then scan: every part reads its input twice but writes only once
+        parallel(parts, reducepart, part, sizeof *part);
+        KahanSum before = {0};
+        for (int i = 0; i < parts; ++i) {
+            const KahanSum total = part[i].total;
+            part[i].total = before;
+            kahanadd(&before, total.s);
+            kahanadd(&before, total.c);
+        }
+    }
+    parallel(parts, scanpart, part, sizeof *part);
+}
+
+typedef struct {
+    const double *x;
+    double *sum;
+    KahanSum *blk;         // pass 1: total of block k; pass 2: total of all blocks before k
+    size_t n, first, last;  // elements, blocks [first, last) of this part
+} ReproPart;
+
+static size_t blockend(const size_t n, const size_t k)
+{
+    return n - k * REPROBLOCK > REPROBLOCK ? (k + 1) * REPROBLOCK : n;
+}
+
+// Pass 1: totals of the blocks of a part
+static void *reproreduce(void *arg)
+{
+    const ReproPart *p = arg;
+    for (size_t k = p->first; k < p->last; ++k) {
+        KahanSum t = {0, 0};
+        for (size_t i = k * REPROBLOCK, end = blockend(p->n, k); i < end; ++i)
+            kahanadd(&t, p->x[i]);
+        p->blk[k] = t;
+    }
+    return NULL;
+}
+
+// Pass 2: running sums of the blocks of a part
+static void *reproscan(void *arg)
+{
+    const ReproPart *p = arg;
+    for (size_t k = p->first; k < p->last; ++k) {
+        KahanSum run = p->blk[k];
+        for (size_t i = k * REPROBLOCK, end = blockend(p->n, k); i < end; ++i) {
+            kahanadd(&run, p->x[i]);
+            p->sum[i] = kahantotal(run);
+        }
+    }
+    return NULL;
+}
+
+// Parts on block boundaries, 0 if there is no point in more than one
+static int reproparts(const double *x, const size_t n, double *sum, const int nthreads, ReproPart *part)
+{
+    const size_t blocks = (n + REPROBLOCK - 1) / REPROBLOCK;
+    const size_t minblocks = MINSCAN / REPROBLOCK;
+    int parts = threadcount(nthreads);
+    if ((size_t)parts > blocks / minblocks)
+        parts = (int)(blocks / minblocks);
+    if (parts <= 1)
+        return 0;
+    KahanSum *blk = malloc(blocks * sizeof *blk);
+    if (!blk)
+        return -1;
+    for (int i = 0; i < parts; ++i)
+        part[i] = (ReproPart){x, sum, blk, n, partstart(blocks, i, parts), partstart(blocks, i + 1, parts)};
+    parallel(parts, reproreduce, part, sizeof *part);
+    KahanSum before = {0, 0};
+    for (size_t k = 0; k < blocks; ++k) {
+        const KahanSum t = blk[k];
+        blk[k] = before;
+        kahanadd(&before, t.s);
+        kahanadd(&before, t.c);
+    }
+    return parts;
+}
+
+bool reprosum(const double *x, const size_t n, double *sum, const int nthreads)
+{
+    ReproPart part[MAXTHREADS];
+    const int parts = reproparts(x, n, sum, nthreads, part);
+    if (parts < 0)
+        return false;
+    if (!parts) {
+        ReproSum r = {0};
+        for (size_t i = 0; i < n; ++i)
+            sum[i] = reproadd(&r, x[i]);
+        return true;
+    }
+    parallel(parts, reproscan, part, sizeof *part);
+    free(part[0].blk);
+    return true;
+}
+
+bool reprototal(const double *x, const size_t n, const int nthreads, double *total)
+{
+    ReproPart part[MAXTHREADS];
+    const int parts = reproparts(x, n, NULL, nthreads, part);
+    if (parts < 0)
+        return false;
+    if (!parts) {
+        ReproSum r = {0};
+        for (size_t i = 0; i < n; ++i)
+            reproadd(&r, x[i]);
+        *total = kahantotal(r.run);
+        return true;
+    }
+    // Only the last block still needs its running sum
+    const size_t k = (n - 1) / REPROBLOCK;
+    KahanSum run = part[0].blk[k];
+    for (size_t i = k * REPROBLOCK; i < n; ++i)
+        kahanadd(&run, x[i]);
+    *total = kahantotal(run);
+    free(part[0].blk);
+    return true;
+}
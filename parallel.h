@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * PARALLEL
+ * Fork-join helpers for data parallel work on a track: run a function on n
+ * threads, each with its own part of the data, and compensated prefix sums
+ * for cumulative distances: a fast one, and a reproducible one that gives
+ * bit-identical results for any number of threads.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include <math.h>     // fabs
+
+#define MAXTHREADS 256
+#define REPROBLOCK 4096  // elements per block of the reproducible sum, part of its definition
+
+// Number of online processors, at least 1
+int cpucount(void);
+
+// Threads to use for a request of n (0 = all processors), at most MAXTHREADS
+int threadcount(const int n);
+
+// Run func on n threads, thread i gets (char *)arg + i * size; the calling
+// thread runs i = 0. Runs everything on the calling thread if threads
+// cannot be started.
+void parallel(const int n, void *(*func)(void *), void *arg, const size_t size);
+
+// Start of part i of n equal parts of [0, len)
+static inline size_t partstart(const size_t len, const int i, const int n)
+{
+    return len / (size_t)n * (size_t)i + len % (size_t)n * (size_t)i / (size_t)n;
+}
+
+// Compensated sum (Kahan-Babuska-Neumaier): the rounding error of every
+// addition is collected in c, the total is s + c
+typedef struct {
+    double s, c;
+} KahanSum;
+
+static inline void kahanadd(KahanSum *k, const double x)
+{
+    const double t = k->s + x;
+    k->c += fabs(k->s) >= fabs(x) ? (k->s - t) + x : (x - t) + k->s;
+    k->s = t;
+}
+
+static inline double kahantotal(const KahanSum k)
+{
+    return k.s + k.c;
+}
+
+// Inclusive prefix sum of x[0..n) into sum (may be x), compensated, on up
+// to nthreads threads (0 = all processors): sum[i] = x[0] + ... + x[i]
+// Rounding depends on the number of threads.
+void prefixsum(const double *x, const size_t n, double *sum, const int nthreads);
+
+// Reproducible sum: x is split in fixed blocks of REPROBLOCK elements. Every
+// block is summed from zero in order; the offset of a block is the
+// compensated sum, in order, of the totals (s and c) of all blocks before
+// it; sum[i] is the compensated running sum from the offset of its block.
+// Only additions in a fixed order, so the result is the same for any number
+// of threads, any SIMD width and any IEEE 754 double machine without excess
+// precision (FLT_EVAL_METHOD 0, e.g. not x87).
+typedef struct {
+    KahanSum before;  // totals of all complete blocks
+    KahanSum block;   // this block from zero
+    KahanSum run;     // before + this block
+    size_t count;     // elements in this block
+} ReproSum;
+
+// Add the next element to a streaming reproducible sum (start from {0}),
+// returns the cumulative sum, equal to reprosum()
+static inline double reproadd(ReproSum *r, const double x)
+{
+    if (r->count == REPROBLOCK) {
+        kahanadd(&r->before, r->block.s);
+        kahanadd(&r->before, r->block.c);
+        r->block = (KahanSum){0, 0};
+        r->run = r->before;
+        r->count = 0;
+    }
+    kahanadd(&r->block, x);
+    kahanadd(&r->run, x);
+    ++r->count;
+    return kahantotal(r->run);
+}
+
+// Reproducible inclusive prefix sum of x[0..n) into sum (may be x) on up to
+// nthreads threads, false if out of memory
+bool reprosum(const double *x, const size_t n, double *sum, const int nthreads);
+
+// Reproducible total of x[0..n), equal to the last element of reprosum(),
+// false if out of memory
+bool reprototal(const double *x, const size_t n, const int nthreads, double *total);
+
+#endif
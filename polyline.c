@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * ENCODED POLYLINE
+ * See polyline.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include "polyline.h"
+
+#define MAXSHIFT 35  // 7 chunks of 5 bits
+
+bool polyinit(PolyState *st, const int precision)
+{
+    if (precision < 1 || precision > 7)
+        return false;
+    int32_t scale = 1;
+    for (int i = precision; i < 7; ++i)
+        scale *= 10;
+    *st = (PolyState){.scale = scale};
+    return true;
+}
+
+// Fixed point to polyline units, rounded half away from zero
+static int64_t tounits(const int32_t x, const int32_t scale)
+{
+    const int64_t half = scale / 2;
+    return x >= 0 ? (x + half) / scale : -((-(int64_t)x + half) / scale);
+}
+
+static char *putvalue(char *p, const int64_t delta)
+{
+    uint64_t u = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    while (u >= 0x20) {
+        *p++ = (char)((0x20 | (u & 0x1f)) + 63);
+        u >>= 5;
+    }
+    *p++ = (char)(u + 63);
+    return p;
+}
+
+size_t polyencode(PolyState *st, const int32_t *lat, const int32_t *lon, const size_t n, char *out)
+{
+    char *p = out;
+    for (size_t i = 0; i < n; ++i) {
+        const int64_t y = tounits(lat[i], st->scale);
+        const int64_t x = tounits(lon[i], st->scale);
+        p = putvalue(p, y - st->lat);
+        p = putvalue(p, x - st->lon);
+        st->lat = y;
+        st->lon = x;
+    }
+    return (size_t)(p - out);
+}
+
+// One value, NULL if invalid or incomplete
+static const char *getvalue(const char *p, const char *end, int64_t *delta)
+{
+    uint64_t u = 0;
+    for (int shift = 0; p < end && shift < MAXSHIFT; shift += 5) {
+        const int c = *p++ - 63;
+        if (c < 0 || c > 63)
+            return NULL;
+        u |= (uint64_t)(c & 0x1f) << shift;
+        if (c < 0x20) {
+            *delta = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+size_t polydecode(PolyState *st, const char **s, const char *end, int32_t *lat, int32_t *lon, const size_t max)
+{
+    const int64_t limit = 180LL * E7 / st->scale;
+    const char *p = *s;
+    size_t n = 0;
+    for (; n < max && p < end; ++n) {
+        int64_t dy, dx;
+        const char *q = getvalue(p, end, &dy);
+        if (!q || !(q = getvalue(q, end, &dx)))
+            break;
+        const int64_t y = st->lat + dy, x = st->lon + dx;
+        if (y < -limit || y > limit || x < -limit || x > limit)
+            break;
+        st->lat = y;
+        st->lon = x;
+        lat[n] = (int32_t)(y * st->scale);
+        lon[n] = (int32_t)(x * st->scale);
+        p = q;
+    }
+    *s = p;
+    return n;
+}
@@ -0,0 +1,46 @@
+/*****************************************************************************
+ * ENCODED POLYLINE
+ * Google's encoded polyline format: coordinates rounded to 1e-5 degrees (or
+ * 1e-6 for precision 6 as used by OSRM and Valhalla), differences with the
+ * previous point zig-zag encoded in chunks of 5 bits, each chunk one
+ * printable character from '?' to '~'. Lat before lon.
+ * Ref.: https://developers.google.com/maps/documentation/utilities/polylinealgorithm
+ *
+ * Encoder and decoder work on batches of fixed point coordinates and keep
+ * the previous point in their state, so a polyline of any length can be
+ * handled in pieces with fixed size buffers.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef POLYLINE_H_
+#define POLYLINE_H_
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int32_t, int64_t
+#include <stdbool.h>  // bool
+#include "track.h"
+
+#define POLYPRECISION 5   // default decimals
+#define POLYMAXLEN    14  // max characters per point for precision up to 7
+
+// Previous point in polyline units and the size of one unit in 1e-7 degrees
+typedef struct {
+    int64_t lat, lon;
+    int32_t scale;
+} PolyState;
+
+// Start encoding or decoding with 1 to 7 decimals, false if out of range
+bool polyinit(PolyState *st, const int precision);
+
+// Encode n points from the fixed point arrays and return the number of
+// characters written to out, which must have room for n * POLYMAXLEN
+size_t polyencode(PolyState *st, const int32_t *lat, const int32_t *lon, const size_t n, char *out);
+
+// Decode up to max points from *s (before end) into the fixed point arrays
+// and return the number of points; *s is moved past the last point. If
+// fewer than max points are returned and *s != end, the input is invalid.
+size_t polydecode(PolyState *st, const char **s, const char *end, int32_t *lat, int32_t *lon, const size_t max);
+
+#endif
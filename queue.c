@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * SPSC QUEUE
+ * See queue.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>  // malloc, free
+#include <sched.h>   // sched_yield
+#include "queue.h"
+
+bool queueinit(Queue *q, const size_t cap)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->mask = cap - 1;
+    return (q->item = malloc(cap * sizeof *q->item)) != NULL;
+}
+
+void queuefree(Queue *q)
+{
+    free(q->item);
+    q->item = NULL;
+}
+
+bool queuetrypush(Queue *q, void *x)
+{
+    const size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    const size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail > q->mask)
+        return false;
+    q->item[head & q->mask] = x;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+void *queuetrypop(Queue *q)
+{
+    const size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail == head)
+        return NULL;
+    void *x = q->item[tail & q->mask];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return x;
+}
+
+void queuepush(Queue *q, void *x)
+{
+    while (!queuetrypush(q, x))
+        sched_yield();
+}
+
+void *queuepop(Queue *q)
+{
+    void *x;
+    while (!(x = queuetrypop(q)))
+        sched_yield();
+    return x;
+}
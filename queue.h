@@ -0,0 +1,41 @@
+/*****************************************************************************
+ * SPSC QUEUE
+ * Bounded lock-free queue of pointers between exactly one producer thread
+ * and one consumer thread, for passing blocks of points between pipeline
+ * stages. Head and tail live on separate cache lines so the two threads do
+ * not invalidate each other's line on every operation.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+#include <stddef.h>     // size_t
+#include <stdbool.h>    // bool
+#include <stdatomic.h>  // _Atomic
+
+#define CACHELINE 64
+
+typedef struct {
+    _Alignas(CACHELINE) _Atomic size_t head;  // next slot to write, only moved by the producer
+    _Alignas(CACHELINE) _Atomic size_t tail;  // next slot to read, only moved by the consumer
+    _Alignas(CACHELINE) size_t mask;          // capacity - 1
+    void **item;
+} Queue;
+
+// Queue with room for cap items (power of 2), false if out of memory
+bool queueinit(Queue *q, const size_t cap);
+
+void queuefree(Queue *q);
+
+// Non-blocking: false if full, NULL if empty
+bool queuetrypush(Queue *q, void *x);
+void *queuetrypop(Queue *q);
+
+// Blocking: yield the CPU until there is room or an item
+void queuepush(Queue *q, void *x);
+void *queuepop(Queue *q);
+
+#endif
@@ -0,0 +1,212 @@
+/*****************************************************************************
+ * ELEVATION SMOOTHING
+ * The centred filters collect the elevations of a run in a buffer with the
+ * half window before them as context, and smooth all values whose window is
+ * complete in one batch: for Savitzky-Golay that is a convolution the
+ * compiler vectorises, one coefficient at a time over the whole batch.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // strtod
+#include <string.h>   // strncmp, strlen, strchr, memmove
+#include <math.h>     // NAN, isnan, floor
+#include "smooth.h"
+
+#define BUFLEN  (2 * SMOOTHMAX + SMOOTHBLOCK)
+#define KALMANQ 0.25  // m^2, variance of the real change in elevation from point to point
+
+const char *const smoothname[SMOOTHERS] = {"none", "sg", "median", "kalman"};
+
+bool smoothinit(Smoother *s, const SmoothKind kind, double param)
+{
+    s->kind = kind;
+    s->len = s->done = 0;
+    s->p = -1;
+    switch (kind) {
+        case SMOOTH_NONE:
+            return true;
+        case SMOOTH_SG:
+        case SMOOTH_MEDIAN:
+            if (param == 0)
+                param = kind == SMOOTH_SG ? 5 : 2;
+            if (!(param >= 1 && param <= SMOOTHMAX) || param != floor(param))
+                return false;
+            s->half = (int)param;
+            // Quadratic least squares fit at the centre of 2m+1 points
+            if (kind == SMOOTH_SG)
+                for (int m = 0; m <= s->half; ++m)
+                    for (int k = 0; k <= m; ++k)
+                        s->coef[m][k] = 3.0 * (3 * m * m + 3 * m - 1 - 5 * k * k) /
+                            ((4.0 * m * m - 1) * (2 * m + 3));
+            return true;
+        case SMOOTH_KALMAN:
+            if (param == 0)
+                param = 3;
+            if (!(param > 0))
+                return false;
+            s->r = param * param;
+            s->q = KALMANQ;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool smoothparse(Smoother *s, const char *spec)
+{
+    const char *colon = strchr(spec, ':');
+    const size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+    for (int i = 0; i < SMOOTHERS; ++i)
+        if (strlen(smoothname[i]) == len && !strncmp(spec, smoothname[i], len)) {
+            double param = 0;
+            if (colon) {
+                char *end;
+                param = strtod(colon + 1, &end);
+                if (end == colon + 1 || *end)
+                    return false;
+            }
+            return smoothinit(s, (SmoothKind)i, param);
+        }
+    return false;
+}
+
+// Half window at buf[c]: what fits on both sides
+static size_t window(const Smoother *s, const size_t c)
+{
+    size_t m = (size_t)s->half;
+    if (m > c)
+        m = c;
+    if (m > s->len - 1 - c)
+        m = s->len - 1 - c;
+    return m;
+}
+
+// Smoothed value of buf[c] with half window m
+static double centred(const Smoother *s, const size_t c, const size_t m)
+{
+    const double *x = s->buf + c;
+    if (s->kind == SMOOTH_SG) {
+        const double *w = s->coef[m];
+        double y = w[0] * x[0];
+        for (size_t k = 1; k <= m; ++k)
+            y += w[k] * (x[-(ptrdiff_t)k] + x[k]);
+        return y;
+    }
+    // Median by insertion sort, windows are small
+    double v[2 * SMOOTHMAX + 1];
+    const size_t n = 2 * m + 1;
+    for (size_t i = 0; i < n; ++i) {
+        const double a = x[(ptrdiff_t)i - (ptrdiff_t)m];
+        size_t j = i;
+        for (; j && v[j - 1] > a; --j)
+            v[j] = v[j - 1];
+        v[j] = a;
+    }
+    return v[m];
+}
+
+// Savitzky-Golay with the full window for buf[from, from + n)
+static void sgbatch(const Smoother *s, const size_t from, const size_t n, double *restrict out)
+{
+    const double *restrict x = s->buf + from;
+    const double *w = s->coef[s->half];
+    for (size_t j = 0; j < n; ++j)
+        out[j] = w[0] * x[j];
+    for (ptrdiff_t k = 1; k <= s->half; ++k) {
+        const double wk = w[k];
+        for (size_t j = 0; j < n; ++j)
+            out[j] += wk * (x[(ptrdiff_t)j - k] + x[j + k]);
+    }
+}
+
+// Write the smoothed values of buf[done, end): up to the last one with a
+// full window during the run, all of them at its end
+static void emit(Smoother *s, const bool last)
+{
+    const size_t h = (size_t)s->half, len = s->len;
+    const size_t end = last ? len : len > h ? len - h : 0;
+    if (end <= s->done)
+        return;
+    double out[BUFLEN];
+    double *o = out - s->done;  // o[c] for buf[c]
+    const size_t full = len > h ? len - h : 0;  // windows are complete in [h, full)
+    size_t c = s->done;
+    for (; c < end && c < h; ++c)
+        o[c] = centred(s, c, window(s, c));
+    const size_t stop = full < end ? full : end;
+    if (c < stop) {
+        if (s->kind == SMOOTH_SG)
+            sgbatch(s, c, stop - c, o + c);
+        else
+            for (size_t i = c; i < stop; ++i)
+                o[i] = centred(s, i, h);
+        c = stop;
+    }
+    for (; c < end; ++c)
+        o[c] = centred(s, c, window(s, c));
+    for (c = s->done; c < end; ++c)
+        *s->dst[c] = o[c];
+    s->done = end;
+}
+
+void smoothpush(Smoother *s, double *ele, const size_t n)
+{
+    if (s->kind == SMOOTH_NONE)
+        return;
+    if (s->kind == SMOOTH_KALMAN) {
+        for (size_t i = 0; i < n; ++i) {
+            const double z = ele[i];
+            if (isnan(z))
+                continue;
+            if (s->p < 0) {
+                s->x = z;
+                s->p = s->r;
+            } else {
+                s->p += s->q;
+                const double k = s->p / (s->p + s->r);
+                s->x += k * (z - s->x);
+                s->p *= 1 - k;
+            }
+            ele[i] = s->x;
+        }
+        return;
+    }
+    const size_t h = (size_t)s->half;
+    for (size_t i = 0; i < n; ++i) {
+        if (isnan(ele[i]))
+            continue;
+        if (s->len == BUFLEN) {
+            // Keep the half window before the first pending value as context
+            emit(s, false);
+            const size_t shift = s->done - h;
+            memmove(s->buf, s->buf + shift, (s->len - shift) * sizeof *s->buf);
+            memmove(s->dst, s->dst + shift, (s->len - shift) * sizeof *s->dst);
+            s->len -= shift;
+            s->done -= shift;
+        }
+        s->buf[s->len] = ele[i];
+        s->dst[s->len++] = &ele[i];
+    }
+    emit(s, false);  // at most half values stay pending
+}
+
+void smoothflush(Smoother *s)
+{
+    if (s->kind != SMOOTH_KALMAN)
+        emit(s, true);
+    s->len = s->done = 0;
+    s->p = -1;
+}
+
+void tracksmooth(Track *t, Smoother *s)
+{
+    if (s->kind == SMOOTH_NONE)
+        return;
+    for (size_t i = 0, n = segcount(t); i < n; ++i) {
+        const size_t first = segfirst(t, i);
+        smoothpush(s, t->ele + first, seglast(t, i) - first);
+        smoothflush(s);
+    }
+}
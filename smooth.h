@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * ELEVATION SMOOTHING
+ * Streaming filters for the elevation column with fixed memory, fed with
+ * the elevations of a track in the order they are read, so smoothing can be
+ * part of the pass that takes the points in (e.g. the compute stage of
+ * gpxfilter) instead of a pass of its own:
+ *
+ *     sg      Savitzky-Golay, least squares quadratic over 2 * half + 1
+ *             points; keeps the shape of hills better than a moving average
+ *     median  median of 2 * half + 1 points, removes single spikes entirely
+ *     kalman  1D Kalman filter with a random walk model, noise is the
+ *             standard deviation of the measurements in metres
+ *
+ * Points without elevation are skipped and stay without. The centred
+ * filters give the smoothed value of a point once half more points have
+ * been fed, so they write it back through a pointer to the elevation;
+ * towards the ends of a run the window shrinks to what is there. Runs end
+ * at segment boundaries with smoothflush().
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef SMOOTH_H_
+#define SMOOTH_H_
+
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include "track.h"
+
+#define SMOOTHMAX   32   // largest half window
+#define SMOOTHBLOCK 256  // elevations per batch of the centred filters
+
+typedef enum {
+    SMOOTH_NONE,
+    SMOOTH_SG,
+    SMOOTH_MEDIAN,
+    SMOOTH_KALMAN,
+    SMOOTHERS  // number of filters
+} SmoothKind;
+
+// Filter names as used on the command line
+extern const char *const smoothname[SMOOTHERS];
+
+typedef struct {
+    SmoothKind kind;
+    int half;            // sg and median: points on either side
+    double r, q;         // kalman: variance of the measurements and the process per point
+    double x, p;         // kalman: estimate and its variance, p < 0 = no estimate yet
+    size_t len, done;    // values in buf, of which [0, done) are written and only context
+    double buf[2 * SMOOTHMAX + SMOOTHBLOCK];   // raw elevations of the run
+    double *dst[2 * SMOOTHMAX + SMOOTHBLOCK];  // where their smoothed values go
+    double coef[SMOOTHMAX + 1][SMOOTHMAX + 1]; // sg: coef[m][|k|] for half window m
+} Smoother;
+
+// Filter kind with parameter param (0 = default: half 5 for sg, 2 for
+// median, noise 3 m for kalman), false if param is out of range
+bool smoothinit(Smoother *s, const SmoothKind kind, const double param);
+
+// Filter by name with optional ":param", e.g. "sg:7"; false if unknown or
+// out of range
+bool smoothparse(Smoother *s, const char *spec);
+
+// Next elevations of the run: ele[0..n), NAN is skipped. Smoothed values are
+// written to ele[] now or during later calls.
+void smoothpush(Smoother *s, double *ele, const size_t n);
+
+// End of the run: write all smoothed values that are still pending
+void smoothflush(Smoother *s);
+
+// Oldest elevation whose smoothed value is still pending, NULL if none
+static inline const double *smoothpending(const Smoother *s)
+{
+    return s->done < s->len ? s->dst[s->done] : NULL;
+}
+
+// Smooth the elevations of every segment of the track in place
+void tracksmooth(Track *t, Smoother *s);
+
+#endif
@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * TRACK SUMMARY
+ * One pass over the track in blocks of DISTBLOCK points: distances for the
+ * block from trackblockdist(), then length, elevation and grades point by
+ * point while the columns are in cache.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <math.h>     // NAN, isnan, isfinite, fmin, fmax, lround
+#include <stdbool.h>  // bool
+#include "stats.h"
+#include "parallel.h" // KahanSum
+
+// State within one segment
+typedef struct {
+    double ele;    // last elevation, NAN if none yet
+    double ref;    // elevation the hysteresis counts from
+    double gdist;  // metres from the first elevation of the current grade
+    double gele;   // that elevation
+    double pend;   // metres since the last elevation
+    int64_t start, end;
+} SegState;
+
+static const SegState segstart = {.ele = NAN, .ref = NAN, .gele = NAN, .start = NOTIME, .end = NOTIME};
+
+void summaryinit(Summary *s)
+{
+    *s = (Summary){.minele = NAN, .maxele = NAN, .mingrade = NAN, .maxgrade = NAN};
+}
+
+void summaryadd(Summary *a, const Summary *b)
+{
+    a->files += b->files;
+    a->points += b->points;
+    a->segments += b->segments;
+    a->length += b->length;
+    a->ascent += b->ascent;
+    a->descent += b->descent;
+    a->rawascent += b->rawascent;
+    a->rawdescent += b->rawdescent;
+    a->minele = fmin(a->minele, b->minele);  // fmin/fmax ignore NAN
+    a->maxele = fmax(a->maxele, b->maxele);
+    a->mingrade = fmin(a->mingrade, b->mingrade);
+    a->maxgrade = fmax(a->maxgrade, b->maxgrade);
+    a->duration += b->duration;
+    for (int i = 0; i < GRADEBINS; ++i)
+        a->grade[i] += b->grade[i];
+}
+
+// Grade in percent over dist metres; only full distances count for min/max
+static void addgrade(Summary *s, const double dist, const double grade, const bool full)
+{
+    const double g = fmax(-GRADEMAX, fmin(GRADEMAX, grade));
+    s->grade[lround(g) + GRADEMAX] += dist;
+    if (full) {
+        s->mingrade = fmin(s->mingrade, grade);
+        s->maxgrade = fmax(s->maxgrade, grade);
+    }
+}
+
+// Next point with elevation e in the segment
+static void addele(Summary *s, SegState *st, const double e, const StatsParams *p)
+{
+    s->minele = fmin(s->minele, e);
+    s->maxele = fmax(s->maxele, e);
+    if (isnan(st->ele)) {
+        st->ref = st->gele = e;
+        st->gdist = st->pend = 0;
+        st->ele = e;
+        return;
+    }
+
+    double d = e - st->ele;
+    if (d > 0)
+        s->rawascent += d;
+    else
+        s->rawdescent -= d;
+    st->ele = e;
+
+    d = e - st->ref;
+    if (d >= p->hysteresis) {
+        s->ascent += d;
+        st->ref = e;
+    } else if (d <= -p->hysteresis) {
+        s->descent -= d;
+        st->ref = e;
+    }
+
+    st->gdist += st->pend;
+    st->pend = 0;
+    if (st->gdist >= p->gradedist && st->gdist > 0) {
+        addgrade(s, st->gdist, (e - st->gele) / st->gdist * 100, true);
+        st->gele = e;
+        st->gdist = 0;
+    }
+}
+
+// What is left of the climb and grade at the end of a segment
+static void segend(Summary *s, const SegState *st)
+{
+    if (!isnan(st->ele)) {
+        const double d = st->ele - st->ref;
+        if (d > 0)
+            s->ascent += d;
+        else
+            s->descent -= d;
+        if (st->gdist > 0)
+            addgrade(s, st->gdist, (st->ele - st->gele) / st->gdist * 100, false);
+    }
+    if (st->start != NOTIME)
+        s->duration += st->end - st->start;
+}
+
+void tracksummary(const Track *t, const Method method, const double tol, const StatsParams *p, Summary *s)
+{
+    static const StatsParams defaults = {HYSTERESIS, GRADEDIST};
+    if (!p)
+        p = &defaults;
+    if (!t->len)
+        return;
+    s->points += t->len;
+
+    double dist[DISTBLOCK];
+    FlatScale sc = {.lat = NAN};
+    const size_t nseg = segcount(t);
+    size_t seg = 0, next = seglast(t, 0);
+    SegState st = segstart;
+    KahanSum len = {0, 0};
+    bool first = true;  // first point of a segment
+    for (size_t i = 0, n; i < t->len; i += n) {
+        n = trackblockdist(t, i, method, tol, &sc, dist);
+        for (size_t j = 0; j < n; ++j) {
+            const size_t k = i + j;
+            if (k == next && seg + 1 < nseg) {
+                segend(s, &st);
+                st = segstart;
+                first = true;
+                while (seglast(t, ++seg) == k && seg + 1 < nseg)  // skip empty segments
+                    ;
+                next = seglast(t, seg);
+            }
+            if (first) {
+                s->segments++;
+                first = false;
+            } else if (isfinite(dist[j])) {  // NAN to or from a point without position
+                kahanadd(&len, dist[j]);
+                st.pend += dist[j];
+            }
+            if (!isnan(t->ele[k]))
+                addele(s, &st, t->ele[k], p);
+            if (t->time[k] != NOTIME) {
+                if (st.start == NOTIME)
+                    st.start = t->time[k];
+                st.end = t->time[k];
+            }
+        }
+    }
+    segend(s, &st);
+    s->length += kahantotal(len);
+}
@@ -0,0 +1,55 @@
+/*****************************************************************************
+ * TRACK SUMMARY
+ * Length, climbing and grades of a whole track in one pass over its columns,
+ * with the distances from the block kernel of track.c so no distance array
+ * is needed. Elevation noise of a few metres between points (e.g. a GPS fix
+ * jumping from 18.57 to 9.91 m and back) is filtered with hysteresis: a
+ * climb or descent only counts once it is at least the threshold, what is
+ * left at the end of a segment counts as is. Grades are measured over a
+ * minimum distance and collected in a histogram of metres per percent.
+ * Summaries of several tracks or files add up to one.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // int64_t
+#include "track.h"
+
+#define GRADEMAX  20                 // percent, outer histogram bins include everything steeper
+#define GRADEBINS (GRADEMAX * 2 + 1) // bin i: grade rounded to whole percent is i - GRADEMAX
+#define HYSTERESIS 5.0               // metres, default elevation threshold
+#define GRADEDIST 100.0              // metres, default distance for one grade
+
+typedef struct {
+    double hysteresis;  // metres, 0 = count every change
+    double gradedist;   // metres, minimum distance between elevations of one grade
+} StatsParams;
+
+typedef struct {
+    size_t files, points, segments;
+    double length;                // metres, within segments
+    double ascent, descent;       // metres, with hysteresis
+    double rawascent, rawdescent; // metres, point to point
+    double minele, maxele;        // metres, NAN if no elevation
+    double mingrade, maxgrade;    // percent, NAN if no grade
+    int64_t duration;             // ms, sum over segments
+    double grade[GRADEBINS];      // metres of track per grade bin
+} Summary;
+
+// Empty summary
+void summaryinit(Summary *s);
+
+// Add summary b to a
+void summaryadd(Summary *a, const Summary *b);
+
+// Add track t to summary s in one pass, distances with the given method;
+// p = NULL for the defaults. Does not count a file. A point without lat/lon
+// adds no length: the distances to and from it are left out, not bridged.
+void tracksummary(const Track *t, const Method method, const double tol, const StatsParams *p, Summary *s);
+
+#endif
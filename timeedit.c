@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * TIME EDITS
+ * See timeedit.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // realloc, free, strtod, strtol
+#include <string.h>   // memmove, strchr
+#include <math.h>     // NAN, llround, isfinite
+#include "timeedit.h"
+
+void timeeditinit(TimeEdit *e, const int64_t shift, const double scale, const bool fill)
+{
+    *e = (TimeEdit){.shift = shift, .scale = scale, .fill = fill, .t0 = NOTIME, .anchor = NOTIME};
+}
+
+void timeeditfree(TimeEdit *e)
+{
+    free(e->slot);
+    free(e->off);
+    e->slot = NULL;
+    e->off = NULL;
+    e->npend = e->cap = 0;
+}
+
+static bool pendpush(TimeEdit *e, int64_t *time)
+{
+    if (e->npend == e->cap) {
+        const size_t cap = e->cap ? e->cap * 2 : 1024;
+        int64_t **slot = realloc(e->slot, cap * sizeof *slot);
+        if (!slot)
+            return false;
+        e->slot = slot;
+        double *off = realloc(e->off, cap * sizeof *off);
+        if (!off)
+            return false;
+        e->off = off;
+        e->cap = cap;
+    }
+    e->slot[e->npend] = time;
+    e->off[e->npend++] = e->run;
+    return true;
+}
+
+// Times of the pending points between the anchor and time t, run metres on
+static void fillgap(TimeEdit *e, const int64_t t)
+{
+    const double dt = (double)(t - e->anchor);
+    if (e->run > 0)
+        for (size_t i = 0; i < e->npend; ++i)
+            *e->slot[i] = e->anchor + llround(dt * (e->off[i] / e->run));
+    else  // no distance: evenly in time
+        for (size_t i = 0; i < e->npend; ++i)
+            *e->slot[i] = e->anchor + llround(dt * (double)(i + 1) / (double)(e->npend + 1));
+    e->npend = 0;
+}
+
+bool timeeditpoint(TimeEdit *e, int64_t *time, const double dist, const bool newseg)
+{
+    if (newseg) {
+        e->anchor = NOTIME;
+        e->npend = 0;
+    }
+    e->run += dist;
+    if (*time == NOTIME)
+        return !e->fill || e->anchor == NOTIME || pendpush(e, time);
+    if (e->t0 == NOTIME)
+        e->t0 = *time;
+    *time = e->t0 + e->shift + (e->scale == 1 ? *time - e->t0 : llround((double)(*time - e->t0) * e->scale));
+    if (e->npend)
+        fillgap(e, *time);
+    e->anchor = *time;
+    e->run = 0;
+    return true;
+}
+
+void timeeditdrop(TimeEdit *e, const int64_t *time, const size_t n)
+{
+    size_t k = 0;
+    while (k < e->npend && e->slot[k] >= time && e->slot[k] < time + n)
+        ++k;
+    if (!k)
+        return;
+    memmove(e->slot, e->slot + k, (e->npend - k) * sizeof *e->slot);
+    memmove(e->off, e->off + k, (e->npend - k) * sizeof *e->off);
+    e->npend -= k;
+}
+
+bool tracktimeedit(Track *t, const Method method, const double tol, TimeEdit *e)
+{
+    double dist[DISTBLOCK];
+    FlatScale sc = {.lat = NAN};
+    size_t s = 0, next = segfirst(t, 0);
+    const size_t nseg = segcount(t);
+    for (size_t i = 0, n; i < t->len; i += n) {
+        n = t->len - i < DISTBLOCK ? t->len - i : DISTBLOCK;
+        if (e->fill)  // only gaps need distances
+            trackblockdist(t, i, method, tol, &sc, dist);
+        for (size_t j = 0; j < n; ++j) {
+            const size_t k = i + j;
+            bool newseg = false;
+            while (k == next && s < nseg) {  // empty segments start at the same point
+                newseg = true;
+                next = ++s < nseg ? segfirst(t, s) : SIZE_MAX;
+            }
+            if (!timeeditpoint(e, &t->time[k], e->fill ? dist[j] : 0, newseg))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool parsetimeshift(const char *s, int64_t *ms)
+{
+    char *end;
+    if (!strchr(s, ':')) {
+        const double sec = strtod(s, &end);
+        if (end == s || *end || !isfinite(sec))
+            return false;
+        *ms = llround(sec * 1000);
+        return true;
+    }
+    const bool neg = *s == '-';
+    if (*s == '+' || *s == '-')
+        ++s;
+    int64_t v = 0;
+    for (int part = 0; part < 3; ++part) {
+        if (*s < '0' || *s > '9')
+            return false;
+        const long x = strtol(s, &end, 10);
+        if (part && (end - s != 2 || x > 59))
+            return false;
+        v = v * 60 + x;
+        s = end;
+        if (!*s) {
+            *ms = (neg ? -v : v) * (part == 1 ? 60000 : 1000);  // HH:MM or HH:MM:SS
+            return part > 0;
+        }
+        if (*s++ != ':')
+            return false;
+    }
+    return false;
+}
@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * TIME EDITS
+ * Edits of the existing timestamps of a track in one streaming pass, for
+ * tracks that have times but not the right ones:
+ *
+ *     shift  add a fixed offset, e.g. for a wrong time zone
+ *     scale  multiply all durations since the first timestamp by a factor,
+ *            e.g. 0.5 to replay twice as fast; the first time stays
+ *     fill   give points without time one between the timed points before
+ *            and after, in proportion to the distance along the track
+ *
+ * Points are fed in order with their distance to the previous point (0 at
+ * the start of a segment). Gaps are only filled within a segment: the time
+ * of a gap between segments is not known. Points without time before the
+ * first or after the last timed point of a segment stay without. Until the
+ * next timed point arrives the points of a gap are pending, kept as
+ * pointers to their time and their distance from the start of the gap.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef TIMEEDIT_H_
+#define TIMEEDIT_H_
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int64_t
+#include <stdbool.h>  // bool
+#include "track.h"
+
+typedef struct {
+    int64_t shift;     // ms added to every time
+    double scale;      // factor for the durations, 1 = keep
+    bool fill;         // interpolate missing times
+    int64_t t0;        // first time of the input, NOTIME before
+    int64_t anchor;    // last edited time in the segment, NOTIME if none
+    double run;        // metres since the anchor
+    int64_t **slot;    // pending points: where their time goes
+    double *off;       // and their metres from the anchor
+    size_t npend, cap;
+} TimeEdit;
+
+// Edits without state; all edits off is shift 0, scale 1, no fill
+void timeeditinit(TimeEdit *e, const int64_t shift, const double scale, const bool fill);
+
+// Release the memory for pending points
+void timeeditfree(TimeEdit *e);
+
+// Next point: time at *time (edited in place), dist metres from the previous
+// point, newseg if it starts a segment; false if out of memory
+bool timeeditpoint(TimeEdit *e, int64_t *time, const double dist, const bool newseg);
+
+// Oldest point whose time is still pending, NULL if none
+static inline const int64_t *timeeditpending(const TimeEdit *e)
+{
+    return e->npend ? e->slot[0] : NULL;
+}
+
+// Give up on the pending points in time[0..n): they stay without time, later
+// points of the gap are still filled
+void timeeditdrop(TimeEdit *e, const int64_t *time, const size_t n);
+
+// All points of the track with distances by the given method; false if out of memory
+bool tracktimeedit(Track *t, const Method method, const double tol, TimeEdit *e);
+
+// Time offset as seconds ("3600", "-1.5") or [+-]HH:MM[:SS] ("+01:00"), false if invalid
+bool parsetimeshift(const char *s, int64_t *ms);
+
+#endif
@@ -0,0 +1,327 @@
+/*****************************************************************************
+ * TRACK STORE
+ * See track.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // malloc, realloc, free
+#include <math.h>     // llround, isnan
+#include "track.h"
+#include "parallel.h"
+
+#define MINPART 4096  // points per thread worth starting a thread for; adaptive scale restarts here
+
+void trackclear(Track *t)
+{
+    t->len = t->nseg = t->ntrk = 0;
+}
+
+void trackfree(Track *t)
+{
+    if (!t->arena) {
+        free(t->lat);
+        free(t->lon);
+        free(t->ele);
+        free(t->time);
+        free(t->seg);
+    }
+    *t = (Track){.arena = t->arena};
+}
+
+// Grow the columns in the arena; the old ones stay until the arena is reset
+static bool arenareserve(Track *t, const size_t n)
+{
+    Arena *a = t->arena;
+    int32_t *lat = arenarealloc(a, t->lat, t->cap * sizeof *lat, n * sizeof *lat);
+    if (lat) t->lat = lat;
+    int32_t *lon = arenarealloc(a, t->lon, t->cap * sizeof *lon, n * sizeof *lon);
+    if (lon) t->lon = lon;
+    double *ele = arenarealloc(a, t->ele, t->cap * sizeof *ele, n * sizeof *ele);
+    if (ele) t->ele = ele;
+    int64_t *time = arenarealloc(a, t->time, t->cap * sizeof *time, n * sizeof *time);
+    if (time) t->time = time;
+    if (!lat || !lon || !ele || !time)
+        return false;
+    t->cap = n;
+    return true;
+}
+
+bool trackreserve(Track *t, const size_t n)
+{
+    if (n <= t->cap)
+        return true;
+    if (t->arena)
+        return arenareserve(t, n);
+    int32_t *lat = realloc(t->lat, n * sizeof *lat);
+    if (lat) t->lat = lat;
+    int32_t *lon = realloc(t->lon, n * sizeof *lon);
+    if (lon) t->lon = lon;
+    double *ele = realloc(t->ele, n * sizeof *ele);
+    if (ele) t->ele = ele;
+    int64_t *time = realloc(t->time, n * sizeof *time);
+    if (time) t->time = time;
+    if (!lat || !lon || !ele || !time)
+        return false;
+    t->cap = n;
+    return true;
+}
+
+bool trackpush(Track *t, const int32_t lat, const int32_t lon, const double ele, const int64_t time)
+{
+    if (t->len == t->cap && !trackreserve(t, t->cap ? t->cap * 2 : 1024))
+        return false;
+    t->lat[t->len] = lat;
+    t->lon[t->len] = lon;
+    t->ele[t->len] = ele;
+    t->time[t->len] = time;
+    t->len++;
+    return true;
+}
+
+bool trackaddseg(Track *t, const size_t first, const size_t trk)
+{
+    if (t->nseg && t->seg[t->nseg - 1].first == first) {
+        t->seg[t->nseg - 1].trk = trk;  // previous one is empty
+        return true;
+    }
+    // Points before the first segment form a segment of their own
+    const size_t need = t->nseg + 1 + (!t->nseg && first);
+    if (need > t->segcap) {
+        const size_t cap = t->segcap ? t->segcap * 2 : 16;
+        Segment *seg = t->arena
+            ? arenarealloc(t->arena, t->seg, t->segcap * sizeof *seg, cap * sizeof *seg)
+            : realloc(t->seg, cap * sizeof *seg);
+        if (!seg)
+            return false;
+        t->seg = seg;
+        t->segcap = cap;
+    }
+    if (!t->nseg && first)
+        t->seg[t->nseg++] = (Segment){0, 0};
+    t->seg[t->nseg++] = (Segment){first, trk};
+    return true;
+}
+
+// One block of segments; for the adaptive method the local scale is kept between blocks
+static void blockdistances(const LineSegment *seg, const size_t n,
+    const Method method, const double tol, FlatScale *sc, double *dist)
+{
+    if (method == ADAPTIVE)
+        for (size_t i = 0; i < n; ++i)
+            dist[i] = adaptive(seg[i], sc, tol);
+    else
+        distances(method, seg, n, dist, tol);
+}
+
+// Distances of points [i, i+n) to their predecessors, within one block
+static void trackblock(const Track *t, const size_t i, const size_t n,
+    const Method method, const double tol, FlatScale *sc, double *dist)
+{
+    LineSegment seg[DISTBLOCK];
+    if (!(i % MINPART))
+        sc->lat = NAN;
+    for (size_t j = 0; j < n; ++j)
+        seg[j] = (LineSegment){{
+            e7rad(t->lat[i + j - 1]), e7rad(t->lon[i + j - 1]),
+            e7rad(t->lat[i + j]), e7rad(t->lon[i + j])}};
+    blockdistances(seg, n, method, tol, sc, dist);
+}
+
+size_t trackblockdist(const Track *t, const size_t i, const Method method, const double tol,
+    FlatScale *sc, double *dist)
+{
+    const size_t n = t->len - i < DISTBLOCK ? t->len - i : DISTBLOCK;
+    if (i)
+        trackblock(t, i, n, method, tol, sc, dist);
+    else {
+        dist[0] = 0;
+        if (n > 1)
+            trackblock(t, 1, n - 1, method, tol, sc, dist + 1);
+    }
+    return n;
+}
+
+void rangedistances(const Track *t, size_t first, const size_t last,
+    const Method method, const double tol, double *dist)
+{
+    if (first >= last)
+        return;
+    if (!first)
+        dist[first++] = 0;
+
+    // Segments in blocks so every method runs its own tight loop over a
+    // batch. Blocks are aligned to DISTBLOCK and the adaptive scale restarts at
+    // every multiple of MINPART, so results do not depend on how a track is
+    // split over threads.
+    FlatScale sc = {.lat = NAN};
+    for (size_t i = first, n; i < last; i += n) {
+        n = DISTBLOCK - i % DISTBLOCK;
+        if (n > last - i)
+            n = last - i;
+        trackblock(t, i, n, method, tol, &sc, dist + i);
+    }
+}
+
+void trackdistances(const Track *t, const Method method, const double tol, double *dist)
+{
+    rangedistances(t, 0, t->len, method, tol, dist);
+}
+
+static void segadd(SegStats *sum, const SegStats *s)
+{
+    if (!s->points)
+        return;
+    sum->points += s->points;
+    sum->length += s->length;
+    sum->ascent += s->ascent;
+    sum->descent += s->descent;
+    sum->duration += s->duration;
+    if (s->start != NOTIME && sum->start == NOTIME)
+        sum->start = s->start;
+    if (s->end != NOTIME)
+        sum->end = s->end;
+}
+
+void trackstats(const Track *t, const Method method, const double tol, SegStats *seg, SegStats *trk)
+{
+    const size_t nseg = segcount(t), ntrk = trkcount(t);
+    for (size_t i = 0; i < nseg; ++i)
+        seg[i] = (SegStats){.start = NOTIME, .end = NOTIME};
+    for (size_t i = 0; i < ntrk; ++i)
+        trk[i] = (SegStats){.start = NOTIME, .end = NOTIME};
+    if (!t->len)
+        return;
+
+    // The segment changes at its first point so that distance is left out
+    double dist[DISTBLOCK];
+    FlatScale sc = {.lat = NAN};
+    size_t s = 0, next = seglast(t, 0);
+    SegStats *cur = seg;
+    KahanSum len = {0, 0};
+    double ele = NAN;
+    for (size_t i = 0, n; i < t->len; i += n) {
+        n = trackblockdist(t, i, method, tol, &sc, dist);
+        for (size_t j = 0; j < n; ++j) {
+            const size_t k = i + j;
+            if (k == next) {
+                cur->length = kahantotal(len);
+                len = (KahanSum){0, 0};
+                ele = NAN;
+                cur = &seg[++s];
+                next = seglast(t, s);
+            } else if (k)
+                kahanadd(&len, dist[j]);
+            cur->points++;
+            if (!isnan(t->ele[k])) {
+                const double d = t->ele[k] - ele;  // NAN at the first elevation
+                if (d > 0)
+                    cur->ascent += d;
+                else if (d < 0)
+                    cur->descent -= d;
+                ele = t->ele[k];
+            }
+            if (t->time[k] != NOTIME) {
+                if (cur->start == NOTIME)
+                    cur->start = t->time[k];
+                cur->end = t->time[k];
+            }
+        }
+    }
+    cur->length = kahantotal(len);
+    for (size_t i = 0; i < nseg; ++i) {
+        if (seg[i].start != NOTIME)
+            seg[i].duration = seg[i].end - seg[i].start;
+        segadd(&trk[segtrk(t, i)], &seg[i]);
+    }
+}
+
+typedef struct {
+    const Track *t;
+    size_t first, last;
+    Method method;
+    double tol;
+    double *dist;
+} DistPart;
+
+static void *distpart(void *arg)
+{
+    const DistPart *p = arg;
+    rangedistances(p->t, p->first, p->last, p->method, p->tol, p->dist);
+    return NULL;
+}
+
+void trackdistancesmt(const Track *t, const Method method, const double tol, double *dist, const int nthreads)
+{
+    int parts = threadcount(nthreads);
+    if ((size_t)parts > t->len / MINPART)
+        parts = t->len / MINPART > 1 ? (int)(t->len / MINPART) : 1;
+    DistPart part[MAXTHREADS];
+    for (int i = 0; i < parts; ++i)
+        part[i] = (DistPart){t, partstart(t->len / MINPART, i, parts) * MINPART,
+            i + 1 < parts ? partstart(t->len / MINPART, i + 1, parts) * MINPART : t->len, method, tol, dist};
+    parallel(parts, distpart, part, sizeof *part);
+}
+
+void pathdistances(const double *lat, const double *lon, const size_t n,
+    const Method method, const double tol, double *dist)
+{
+    if (!n)
+        return;
+    dist[0] = 0;
+    LineSegment seg[DISTBLOCK];
+    FlatScale sc = {.lat = NAN};
+    for (size_t i = 1; i < n; i += DISTBLOCK) {
+        size_t m = n - i < DISTBLOCK ? n - i : DISTBLOCK;
+        for (size_t j = 0; j < m; ++j)
+            seg[j] = (LineSegment){{
+                lat[i + j - 1] * DEG2RAD, lon[i + j - 1] * DEG2RAD,
+                lat[i + j] * DEG2RAD, lon[i + j] * DEG2RAD}};
+        blockdistances(seg, m, method, tol, &sc, dist + i);
+    }
+}
+
+typedef struct {
+    Track *t;
+    const double *cum;
+    size_t first, last;
+    int64_t start;
+    double msperm;  // ms per metre
+} TimePart;
+
+static void *timepart(void *arg)
+{
+    const TimePart *p = arg;
+    for (size_t i = p->first; i < p->last; ++i)
+        p->t->time[i] = p->start + llround(p->cum[i] * p->msperm);
+    return NULL;
+}
+
+bool trackretimemt(Track *t, const double *dist, const int64_t start, const double speed, const int nthreads)
+{
+    double *cum = t->arena ? arenaalloc(t->arena, t->len * sizeof *cum) : malloc(t->len * sizeof *cum);
+    if (!cum)
+        return false;
+    prefixsum(dist, t->len, cum, nthreads);
+    int parts = threadcount(nthreads);
+    if ((size_t)parts > t->len / MINPART)
+        parts = t->len / MINPART > 1 ? (int)(t->len / MINPART) : 1;
+    TimePart part[MAXTHREADS];
+    for (int i = 0; i < parts; ++i)
+        part[i] = (TimePart){t, cum, partstart(t->len, i, parts), partstart(t->len, i + 1, parts), start, 1000 / speed};
+    parallel(parts, timepart, part, sizeof *part);
+    if (!t->arena)
+        free(cum);
+    return true;
+}
+
+void trackretime(Track *t, const double *dist, const int64_t start, const double speed)
+{
+    KahanSum sum = {0};
+    const double msperm = 1000 / speed;
+    for (size_t i = 0; i < t->len; ++i) {
+        kahanadd(&sum, dist[i]);
+        t->time[i] = start + llround(kahantotal(sum) * msperm);
+    }
+}
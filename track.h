@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * TRACK STORE
+ * Track points as separate arrays per column (structure of arrays) so the
+ * distance kernels and the statistics run over contiguous memory. The trk
+ * and trkseg elements of a GPX file are kept as a list of segment starts,
+ * so statistics never join two segments across a gap.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef TRACK_H_
+#define TRACK_H_
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int64_t
+#include <stdbool.h>  // bool
+#include "geodesic.h"
+#include "arena.h"
+
+#define NOTIME INT64_MIN  // time column value for points without a timestamp
+#define NOCOOR INT32_MIN  // lat or lon column value for a missing coordinate
+#define E7 10000000       // fixed point coordinate units per degree
+#define E7RAD (DEG2RAD / E7)
+#define DISTBLOCK 256     // points per block of distance calculations
+
+// Track points: latitude and longitude in 1e-7 degrees (about 1 cm, the most
+// decimals found in GPX files, so every coordinate with up to 7 decimals is
+// stored exactly), elevation in metres (NAN if missing), time in milliseconds
+// since 1970-01-01T00:00:00Z. Columns are on the heap, or in the arena if
+// one is set (then trackfree() only forgets them, arenareset() frees them).
+typedef struct {
+    size_t first;  // first point
+    size_t trk;    // index of the trk element it belongs to
+} Segment;
+
+// Segment i is points [seg[i].first, seg[i + 1].first), the last one up to
+// len. Without segments (nseg = 0) all points form one segment; with
+// segments, seg[0].first = 0 and only the last segment can be empty.
+typedef struct {
+    size_t len, cap;
+    int32_t *lat, *lon;
+    double *ele;
+    int64_t *time;
+    Segment *seg;
+    size_t nseg, segcap;
+    size_t ntrk;   // trk elements seen
+    Arena *arena;
+} Track;
+
+// Length, climbing and duration of a segment or a whole trk
+typedef struct {
+    size_t points;
+    double length;           // metres, from point to point within segments
+    double ascent, descent;  // metres, between consecutive points with elevation
+    int64_t start, end;      // first and last timestamp, NOTIME if none
+    int64_t duration;        // ms, end - start; for a trk the sum over its segments
+} SegStats;
+
+// Degrees to fixed point, NOCOOR if not a number or out of range
+static inline int32_t toe7(const double deg)
+{
+    return fabs(deg) <= 180 ? (int32_t)lround(deg * E7) : NOCOOR;
+}
+
+// The same for a latitude, which goes no further than the poles
+static inline int32_t late7(const double deg)
+{
+    return fabs(deg) <= 90 ? (int32_t)lround(deg * E7) : NOCOOR;
+}
+
+// Fixed point to degrees or radians, NAN if missing
+static inline double e7deg(const int32_t x)
+{
+    return x == NOCOOR ? NAN : (double)x / E7;
+}
+
+static inline double e7rad(const int32_t x)
+{
+    return x == NOCOOR ? NAN : x * E7RAD;
+}
+
+// Number of segments and trk elements, at least 1 each for a non-empty track
+static inline size_t segcount(const Track *t)
+{
+    return t->nseg ? t->nseg : t->len > 0;
+}
+
+static inline size_t trkcount(const Track *t)
+{
+    return t->ntrk ? t->ntrk : segcount(t) > 0;
+}
+
+// Points [first, last) and trk index of segment i < segcount()
+static inline size_t segfirst(const Track *t, const size_t i)
+{
+    return t->nseg ? t->seg[i].first : 0;
+}
+
+static inline size_t seglast(const Track *t, const size_t i)
+{
+    return i + 1 < t->nseg ? t->seg[i + 1].first : t->len;
+}
+
+static inline size_t segtrk(const Track *t, const size_t i)
+{
+    return t->nseg ? t->seg[i].trk : 0;
+}
+
+// Empty the track but keep its memory
+void trackclear(Track *t);
+
+// Release all memory of the track, keep the arena
+void trackfree(Track *t);
+
+// Make room for at least n points, false if out of memory
+bool trackreserve(Track *t, const size_t n);
+
+// Append one point, false if out of memory
+bool trackpush(Track *t, const int32_t lat, const int32_t lon, const double ele, const int64_t time);
+
+// A new segment starts at point first (>= the start of the last segment) in
+// trk element trk; an empty last segment is replaced. False if out of memory.
+bool trackaddseg(Track *t, const size_t first, const size_t trk);
+
+// Start of a trk element, and of a trkseg element at the next point
+static inline void tracknewtrk(Track *t)
+{
+    t->ntrk++;
+}
+
+static inline bool tracknewseg(Track *t)
+{
+    return trackaddseg(t, t->len, t->ntrk ? t->ntrk - 1 : 0);
+}
+
+// Distance in metres from point i-1 to point i for every point (dist[0] = 0)
+void trackdistances(const Track *t, const Method method, const double tol, double *dist);
+
+// Distances of the points in block [i, i + DISTBLOCK) to their predecessors
+// in dist[0..n), returns n. Calls for i = 0, DISTBLOCK, 2 * DISTBLOCK, ...
+// with sc = {.lat = NAN} at the start give the same distances as
+// trackdistances() without an array for the whole track.
+size_t trackblockdist(const Track *t, const size_t i, const Method method, const double tol,
+    FlatScale *sc, double *dist);
+
+// Distances for points [first, last) only
+void rangedistances(const Track *t, size_t first, const size_t last,
+    const Method method, const double tol, double *dist);
+
+// trackdistances() on up to nthreads threads (0 = all processors)
+void trackdistancesmt(const Track *t, const Method method, const double tol, double *dist, const int nthreads);
+
+// Same for a path of n points with coordinates in decimal degrees
+void pathdistances(const double *lat, const double *lon, const size_t n,
+    const Method method, const double tol, double *dist);
+
+// Timestamps at constant speed in m/s from start time in ms, using the
+// distances from trackdistances(); cumulative distance is a compensated sum
+void trackretime(Track *t, const double *dist, const int64_t start, const double speed);
+
+// Statistics of every segment (segcount() elements) and every trk (trkcount()
+// elements) in one pass over the points, with the same distances as
+// trackdistances() but without the jumps between segments
+void trackstats(const Track *t, const Method method, const double tol, SegStats *seg, SegStats *trk);
+
+// The same with a parallel prefix sum on up to nthreads threads (0 = all
+// processors), false if out of memory
+bool trackretimemt(Track *t, const double *dist, const int64_t start, const double speed, const int nthreads);
+
+#endif
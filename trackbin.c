@@ -0,0 +1,218 @@
+/*****************************************************************************
+ * PACKED TRACK FORMAT
+ * See trackbin.h. Deltas between GPS fixes are small, so most varints are a
+ * single byte: the decoder checks 8 bytes at once and unpacks them without
+ * branches when none of them has a continuation bit.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <string.h>   // memcpy, memcmp, memmove
+#include <math.h>     // isnan, llround, NAN
+#include "trackbin.h"
+
+#define VERSION   1
+#define MAXVARINT 10   // bytes in the longest 64-bit varint
+#define COLUMNS   4
+#define CONTBITS  0x8080808080808080ULL  // continuation bit of 8 bytes
+
+static const char magic[4] = {'G', 'P', 'X', 'B'};
+
+static uint64_t zigzag(const int64_t x)
+{
+    return ((uint64_t)x << 1) ^ (uint64_t)(x >> 63);
+}
+
+static int64_t unzigzag(const uint64_t u)
+{
+    return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+static uint8_t *putvarint(uint8_t *p, uint64_t x)
+{
+    while (x >= 0x80) {
+        *p++ = (uint8_t)(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = (uint8_t)x;
+    return p;
+}
+
+// One varint, NULL if it runs past the end or is too long
+static const uint8_t *getvarint(const uint8_t *p, const uint8_t *end, uint64_t *x)
+{
+    uint64_t val = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const uint8_t b = *p++;
+        val |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *x = val;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// n varints, NULL if invalid
+static const uint8_t *getvarints(const uint8_t *p, const uint8_t *end, const size_t n, uint64_t *x)
+{
+    size_t i = 0;
+    while (i < n) {
+        uint64_t w;
+        if (n - i >= 8 && end - p >= 8 && (memcpy(&w, p, 8), !(w & CONTBITS))) {
+            // 8 single byte varints
+            for (int k = 0; k < 8; ++k)
+                x[i + k] = p[k];
+            i += 8;
+            p += 8;
+        } else if (!(p = getvarint(p, end, &x[i++])))
+            return NULL;
+    }
+    return p;
+}
+
+// Elevation in mm, 0 = missing
+static int64_t elemm(const double ele)
+{
+    return isnan(ele) ? 0 : llround(ele * 1000);
+}
+
+static uint8_t *packblock(const Track *t, const size_t first, const size_t n, const int flags, uint8_t *p)
+{
+    int64_t prev = 0;
+    for (size_t i = first; i < first + n; prev = t->lat[i++])
+        p = putvarint(p, zigzag(t->lat[i] - prev));
+    prev = 0;
+    for (size_t i = first; i < first + n; prev = t->lon[i++])
+        p = putvarint(p, zigzag(t->lon[i] - prev));
+    if (flags & PACK_ELE) {
+        prev = 0;
+        for (size_t i = first; i < first + n; ++i) {
+            if (isnan(t->ele[i]))
+                *p++ = 0;
+            else {
+                const int64_t mm = elemm(t->ele[i]);
+                p = putvarint(p, zigzag(mm - prev) + 1);
+                prev = mm;
+            }
+        }
+    }
+    if (flags & PACK_TIME) {
+        prev = 0;
+        for (size_t i = first; i < first + n; ++i) {
+            if (t->time[i] == NOTIME)
+                *p++ = 0;
+            else {
+                p = putvarint(p, zigzag(t->time[i] - prev) + 1);
+                prev = t->time[i];
+            }
+        }
+    }
+    return p;
+}
+
+bool trackpack(const Track *t, TextBuffer *out)
+{
+    int flags = 0;
+    for (size_t i = 0; i < t->len && flags != (PACK_ELE | PACK_TIME); ++i) {
+        if (!isnan(t->ele[i]))
+            flags |= PACK_ELE;
+        if (t->time[i] != NOTIME)
+            flags |= PACK_TIME;
+    }
+    if (!bufreserve(out, PACKHEADER))
+        return false;
+    uint8_t *p = (uint8_t *)out->buf + out->len;
+    memcpy(p, magic, sizeof magic);
+    p[4] = VERSION;
+    p[5] = (uint8_t)flags;
+    p[6] = p[7] = 0;
+    out->len += PACKHEADER;
+
+    for (size_t i = 0; i < t->len; i += PACKBLOCK) {
+        const size_t n = t->len - i < PACKBLOCK ? t->len - i : PACKBLOCK;
+        // Payload first, after room for the block header, then moved into place
+        if (!bufreserve(out, 2 * MAXVARINT + n * COLUMNS * MAXVARINT))
+            return false;
+        uint8_t *head = (uint8_t *)out->buf + out->len;
+        uint8_t *payload = head + 2 * MAXVARINT;
+        const size_t size = (size_t)(packblock(t, i, n, flags, payload) - payload);
+        p = putvarint(putvarint(head, n), size);
+        memmove(p, payload, size);
+        out->len = (size_t)(p + size - (uint8_t *)out->buf);
+    }
+    return true;
+}
+
+int packedflags(const char *buf, const size_t len)
+{
+    if (len < PACKHEADER || memcmp(buf, magic, sizeof magic) || buf[4] != VERSION
+        || (buf[5] & ~(PACK_ELE | PACK_TIME)))
+        return -1;
+    return buf[5];
+}
+
+UnpackStatus unpackblock(const char **buf, const char *end, const int flags, Track *t)
+{
+    const uint8_t *p = (const uint8_t *)*buf, *e = (const uint8_t *)end;
+    uint64_t n, size;
+    if (!(p = getvarint(p, e, &n)) || !(p = getvarint(p, e, &size))
+        || !n || n > PACKBLOCK || size > (uint64_t)(e - p))
+        return UNPACK_FORMAT;
+    e = p + size;
+    if (!trackreserve(t, t->len + n))
+        return UNPACK_NOMEM;
+
+    // Columns are decoded into a scratch array, then summed into the track
+    uint64_t x[PACKBLOCK];
+    const size_t first = t->len;
+    int64_t acc = 0;
+    if (!(p = getvarints(p, e, n, x)))
+        return UNPACK_FORMAT;
+    for (size_t i = 0; i < n; ++i)
+        t->lat[first + i] = (int32_t)(acc += unzigzag(x[i]));
+    acc = 0;
+    if (!(p = getvarints(p, e, n, x)))
+        return UNPACK_FORMAT;
+    for (size_t i = 0; i < n; ++i)
+        t->lon[first + i] = (int32_t)(acc += unzigzag(x[i]));
+    if (flags & PACK_ELE) {
+        acc = 0;
+        if (!(p = getvarints(p, e, n, x)))
+            return UNPACK_FORMAT;
+        for (size_t i = 0; i < n; ++i)
+            t->ele[first + i] = x[i] ? (acc += unzigzag(x[i] - 1)) / 1e3 : NAN;
+    } else
+        for (size_t i = 0; i < n; ++i)
+            t->ele[first + i] = NAN;
+    if (flags & PACK_TIME) {
+        acc = 0;
+        if (!(p = getvarints(p, e, n, x)))
+            return UNPACK_FORMAT;
+        for (size_t i = 0; i < n; ++i)
+            t->time[first + i] = x[i] ? (acc += unzigzag(x[i] - 1)) : NOTIME;
+    } else
+        for (size_t i = 0; i < n; ++i)
+            t->time[first + i] = NOTIME;
+    if (p != e)
+        return UNPACK_FORMAT;
+    t->len += n;
+    *buf = (const char *)e;
+    return UNPACK_OK;
+}
+
+UnpackStatus trackunpack(const char *buf, const size_t len, Track *t)
+{
+    const int flags = packedflags(buf, len);
+    if (flags < 0)
+        return UNPACK_FORMAT;
+    const char *end = buf + len;
+    buf += PACKHEADER;
+    while (buf < end) {
+        const UnpackStatus status = unpackblock(&buf, end, flags, t);
+        if (status != UNPACK_OK)
+            return status;
+    }
+    return UNPACK_OK;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * PACKED TRACK FORMAT
+ * Compact binary track file, about 6x smaller than GPX text and decoded
+ * without any number parsing. Layout, all integers little endian:
+ *
+ *     header  "GPXB", version (1 byte), column flags (1 byte), 2 zero bytes
+ *     blocks  count (varint), payload size in bytes (varint), payload
+ *
+ * A block payload holds up to PACKBLOCK points as columns of varints, one
+ * column after the other: lat and lon in 1e-7 degrees, then elevation in mm
+ * if flag PACK_ELE is set, then time in ms if flag PACK_TIME is set. Every
+ * value is the zig-zag encoded difference with the previous point in the
+ * same block, so every block can be decoded on its own. Elevation and time
+ * values are shifted up by one to make 0 mean "missing".
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef TRACKBIN_H_
+#define TRACKBIN_H_
+
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+#include "gpxio.h"
+
+#define PACKBLOCK  4096  // max points per block
+#define PACKHEADER 8     // bytes in the file header
+
+// Column flags
+#define PACK_ELE  1
+#define PACK_TIME 2
+
+typedef enum {
+    UNPACK_OK,
+    UNPACK_NOMEM,   // out of memory
+    UNPACK_FORMAT,  // not a packed track or corrupt data
+} UnpackStatus;
+
+// Append the track in packed format to the buffer, false if out of memory
+bool trackpack(const Track *t, TextBuffer *out);
+
+// Column flags from the header, or -1 if buf does not start with a packed track header
+int packedflags(const char *buf, const size_t len);
+
+// Decode the block at *buf (before end) and append its points to the track;
+// *buf is moved past the block
+UnpackStatus unpackblock(const char **buf, const char *end, const int flags, Track *t);
+
+// Append all points of a packed track to the track
+UnpackStatus trackunpack(const char *buf, const size_t len, Track *t);
+
+#endif
@@ -0,0 +1,180 @@
+/*****************************************************************************
+ * WAYPOINTS AND ROUTES
+ * See waypoints.h.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#include <stdlib.h>   // malloc, realloc, free
+#include <string.h>   // memcpy
+#include <math.h>     // cos, isfinite, INFINITY, NAN
+#include "waypoints.h"
+#include "parallel.h"
+
+#define NEARBLOCK 2048  // track points per block of the nearest point search, fits in L1 with its distances
+
+// Grow an array in the arena of the points, or on the heap
+static void *grow(Arena *a, void *p, const size_t oldsize, const size_t newsize)
+{
+    return a ? arenarealloc(a, p, oldsize, newsize) : realloc(p, newsize);
+}
+
+void wptclear(Waypoints *w)
+{
+    trackclear(&w->pts);
+    w->textlen = 0;
+}
+
+void wptfree(Waypoints *w)
+{
+    if (!w->pts.arena) {
+        free(w->name);
+        free(w->text);
+    }
+    trackfree(&w->pts);
+    *w = (Waypoints){.pts = w->pts};
+}
+
+bool wptpush(Waypoints *w, const int32_t lat, const int32_t lon, const double ele, const int64_t time,
+    const char *s, const size_t len)
+{
+    Track *t = &w->pts;
+    if (t->len == w->namecap) {
+        const size_t cap = w->namecap ? w->namecap * 2 : 64;
+        size_t *name = grow(t->arena, w->name, w->namecap * sizeof *name, cap * sizeof *name);
+        if (!name)
+            return false;
+        w->name = name;
+        w->namecap = cap;
+    }
+    size_t off = NONAME;
+    if (s) {
+        if (w->textlen + len + 1 > w->textcap) {
+            size_t cap = w->textcap ? w->textcap * 2 : 1024;
+            while (cap < w->textlen + len + 1)
+                cap *= 2;
+            char *text = grow(t->arena, w->text, w->textcap, cap);
+            if (!text)
+                return false;
+            w->text = text;
+            w->textcap = cap;
+        }
+        off = w->textlen;
+        memcpy(w->text + off, s, len);
+        w->text[off + len] = '\0';
+        w->textlen += len + 1;
+    }
+    if (!trackpush(t, lat, lon, ele, time))
+        return false;
+    w->name[t->len - 1] = off;
+    return true;
+}
+
+// Longitude difference in 1e-7 degrees wrapped into [-180, 180] degrees, so
+// that points on either side of the antimeridian are near. Rounds to whole
+// turns with the 1.5 * 2^52 trick instead of rint() or a compare, which
+// would keep the nearest point loop from vectorising.
+static inline double wrapdx(const double dx)
+{
+    const double turns = (dx * (1 / (360.0 * E7)) + 0x1.8p52) - 0x1.8p52;
+    return dx - turns * (360.0 * E7);
+}
+
+// Point i > 0 starts a segment, so there is no track between i-1 and i
+static bool segstart(const Track *t, const size_t i)
+{
+    size_t lo = 0, hi = t->nseg;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (t->seg[mid].first < i)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return i && lo < t->nseg && t->seg[lo].first == i;
+}
+
+bool wptalong(const Track *t, const Waypoints *w, const Method method, const double tol, WptMatch *m)
+{
+    const Track *p = &w->pts;
+    const size_t n = t->len, nw = p->len;
+    for (size_t k = 0; k < nw; ++k)
+        m[k] = (WptMatch){SIZE_MAX, NAN, NAN};
+    if (!n || !nw)
+        return true;
+    const size_t size = (n + 2 * nw) * sizeof(double);
+    double *cum = t->arena ? arenaalloc(t->arena, size) : malloc(size);
+    if (!cum)
+        return false;
+    double *best = cum + n, *scale = best + nw;
+
+    // Cumulative distance without the jumps between segments, and without
+    // the NAN distances to and from points that have no position
+    trackdistances(t, method, tol, cum);
+    for (size_t s = 1; s < t->nseg; ++s)
+        if (t->seg[s].first < n)
+            cum[t->seg[s].first] = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (!isfinite(cum[i]))
+            cum[i] = 0;
+    prefixsum(cum, n, cum, 1);
+
+    // Nearest track point of every waypoint by squared distance in 1e-7
+    // degrees on a flat earth, longitude scaled to the waypoint's latitude.
+    // All waypoints per block of the track, the distances in a separate loop
+    // that vectorises.
+    for (size_t k = 0; k < nw; ++k) {
+        best[k] = INFINITY;
+        scale[k] = cos(e7rad(p->lat[k]));  // NAN without position: never nearer
+    }
+    double d[NEARBLOCK];
+    for (size_t b = 0; b < n; b += NEARBLOCK) {
+        const size_t len = n - b < NEARBLOCK ? n - b : NEARBLOCK;
+        const int32_t *lat = t->lat + b, *lon = t->lon + b;
+        for (size_t k = 0; k < nw; ++k) {
+            const double wlat = p->lat[k], wlon = p->lon[k], c = scale[k];
+            for (size_t i = 0; i < len; ++i) {
+                const double dy = lat[i] - wlat, dx = wrapdx(lon[i] - wlon) * c;
+                d[i] = dy * dy + dx * dx;
+            }
+            for (size_t i = 0; i < len; ++i)
+                if (d[i] < best[k]) {
+                    best[k] = d[i];
+                    m[k].index = b + i;
+                }
+        }
+    }
+
+    // Nearest position on the segments before and after the nearest point
+    for (size_t k = 0; k < nw; ++k) {
+        const size_t j = m[k].index;
+        if (j == SIZE_MAX)
+            continue;
+        const double wlat = p->lat[k], wlon = p->lon[k], c = scale[k];
+        double bestd = best[k], along = cum[j], lat = t->lat[j], lon = t->lon[j];
+        for (size_t a = j ? j - 1 : 0; a <= j && a + 1 < n; ++a) {
+            if (segstart(t, a + 1) || t->lat[a] == NOCOOR || t->lat[a + 1] == NOCOOR)
+                continue;
+            const double ax = wrapdx(t->lon[a] - wlon) * c, ay = t->lat[a] - wlat;
+            const double dlon = wrapdx((double)t->lon[a + 1] - t->lon[a]);
+            const double vx = dlon * c, vy = (double)t->lat[a + 1] - t->lat[a];
+            const double len2 = vx * vx + vy * vy;
+            double f = len2 > 0 ? -(ax * vx + ay * vy) / len2 : 0;
+            f = f < 0 ? 0 : (f > 1 ? 1 : f);
+            const double px = ax + f * vx, py = ay + f * vy, d2 = px * px + py * py;
+            if (d2 < bestd) {
+                bestd = d2;
+                along = cum[a] + f * (cum[a + 1] - cum[a]);
+                lat = t->lat[a] + f * vy;
+                lon = t->lon[a] + f * dlon;
+            }
+        }
+        const LineSegment seg = {{e7rad(p->lat[k]), e7rad(p->lon[k]), lat * E7RAD, lon * E7RAD}};
+        distances(method, &seg, 1, &m[k].offset, tol);
+        m[k].along = along;
+    }
+    if (!t->arena)
+        free(cum);
+    return true;
+}
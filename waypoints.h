@@ -0,0 +1,62 @@
+/*****************************************************************************
+ * WAYPOINTS AND ROUTES
+ * Points of wpt and rtept elements, with their names, read in the same pass
+ * as the track points. Positions are kept in a Track so they have the same
+ * columns and units; for routes every rte element is a trk and segment of
+ * that track. Names of all points are in one text buffer.
+ *
+ * Matching waypoints to a track gives the distance along the track to each
+ * waypoint: the nearest track point is found for all waypoints at once in
+ * blocks of the track that stay in cache, then the position is refined on
+ * the two track segments next to that point.
+ *
+ * Author: E. Dronkert https://github.com/ednl
+ * Licence: MIT (free to use as you like, with attribution)
+ *****************************************************************************/
+
+#ifndef WAYPOINTS_H_
+#define WAYPOINTS_H_
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // int32_t, int64_t, SIZE_MAX
+#include <stdbool.h>  // bool
+#include "track.h"
+
+#define NONAME SIZE_MAX  // name offset of a point without name
+
+typedef struct {
+    Track pts;
+    size_t *name;       // per point: offset of its name in text, NONAME if none
+    size_t namecap;
+    char *text;         // NUL-terminated names
+    size_t textlen, textcap;
+} Waypoints;
+
+// Waypoint on a track
+typedef struct {
+    size_t index;   // nearest track point, SIZE_MAX if the track or waypoint has no position
+    double along;   // metres along the track (without gaps) to the nearest position on it
+    double offset;  // metres from the waypoint to that position
+} WptMatch;
+
+// Empty, but keep the memory
+void wptclear(Waypoints *w);
+
+// Release all memory
+void wptfree(Waypoints *w);
+
+// Append a point with name s[0..len) (NULL = no name), false if out of memory
+bool wptpush(Waypoints *w, const int32_t lat, const int32_t lon, const double ele, const int64_t time,
+    const char *s, const size_t len);
+
+// Name of point i, "" if none
+static inline const char *wptname(const Waypoints *w, const size_t i)
+{
+    return w->name[i] == NONAME ? "" : w->text + w->name[i];
+}
+
+// Match every waypoint to the track, distances with the given method; false
+// if out of memory
+bool wptalong(const Track *t, const Waypoints *w, const Method method, const double tol, WptMatch *m);
+
+#endif